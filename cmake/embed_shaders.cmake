@@ -0,0 +1,41 @@
+# Run by sepgfx_embed_shaders through cmake -P.
+# Writes every file in INPUTS into SOURCE as a null terminated byte array, named by its path relative to BASE_DIR,
+# and declares the table of them in HEADER.
+string(MAKE_C_IDENTIFIER "${NAME}" TABLE)
+string(TOUPPER "${TABLE}" GUARD)
+set(COUNT_MACRO ${GUARD}_COUNT)
+list(LENGTH INPUTS COUNT)
+
+set(ARRAYS "")
+set(ENTRIES "")
+set(INDEX 0)
+foreach(INPUT IN LISTS INPUTS)
+    file(RELATIVE_PATH RELATIVE "${BASE_DIR}" "${INPUT}")
+    file(READ "${INPUT}" HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR SIZE "${HEX_LENGTH} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+    string(APPEND ARRAYS "static const unsigned char ${TABLE}_${INDEX}[] = {${BYTES}0x00};\n")
+    string(APPEND ENTRIES "    {\"${RELATIVE}\", (const char *)${TABLE}_${INDEX}, ${SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+file(WRITE "${HEADER}" "// Generated by sepgfx_embed_shaders, do not edit.
+#ifndef ${GUARD}_H
+#define ${GUARD}_H
+
+#include <sf/math.h>
+#include \"sf/gfx/shaders.h\"
+
+#define ${COUNT_MACRO} ${COUNT}
+extern const sf_shader_file ${TABLE}[${COUNT_MACRO}];
+
+#endif
+")
+file(WRITE "${SOURCE}" "// Generated by sepgfx_embed_shaders, do not edit.
+#include \"${NAME}.h\"
+
+${ARRAYS}
+const sf_shader_file ${TABLE}[${COUNT_MACRO}] = {
+${ENTRIES}};
+")
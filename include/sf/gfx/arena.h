@@ -0,0 +1,75 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "export.h"
+#include "sf/gfx/vertices.h"
+
+/// Marks an allocation that didn't fit.
+#define SF_ARENA_NONE SIZE_MAX
+
+/// A range of an arena buffer, in the units of its allocator.
+typedef struct {
+    size_t offset, size;
+} sf_arena_range;
+
+/// A first-fit allocator over the ranges of a buffer.
+/// Free ranges are kept sorted by offset, and merged with their neighbours when released.
+typedef struct {
+    sf_arena_range *free;
+    size_t count, capacity;
+    /// Size of the whole buffer.
+    size_t size;
+} sf_arena_allocator;
+
+/// Create an allocator over a buffer of size units, all of it free.
+EXPORT sf_arena_allocator sf_arena_allocator_new(size_t size);
+/// Free an allocator's list of free ranges.
+EXPORT void sf_arena_allocator_free(sf_arena_allocator *allocator);
+/// Take size units from the first free range they fit in.
+/// Returns the offset of the allocation, or SF_ARENA_NONE if no range is big enough.
+EXPORT size_t sf_arena_alloc(sf_arena_allocator *allocator, size_t size);
+/// Give a range back to an allocator. Empty ranges are ignored.
+EXPORT void sf_arena_release(sf_arena_allocator *allocator, sf_arena_range range);
+/// Grow the buffer an allocator covers to size units, freeing the new space at the end.
+EXPORT void sf_arena_grow(sf_arena_allocator *allocator, size_t size);
+/// Get the total size of the free ranges of an allocator.
+EXPORT size_t sf_arena_free_size(const sf_arena_allocator *allocator);
+/// Get how fragmented the free space of an allocator is, from 0 (one free range) to 1.
+EXPORT float sf_arena_fragmentation(const sf_arena_allocator *allocator);
+
+/// Fragmentation above which an arena is worth compacting.
+#define SF_ARENA_COMPACT_THRESHOLD 0.5f
+
+/// One vertex and index buffer pair shared by many meshes of the same layout, under a single vao.
+/// Meshes are handed ranges of both buffers, and are drawn with a base vertex instead of a vao of their own.
+/// Indices are allocated in bytes, so 16 and 32-bit meshes can share the index buffer.
+/// The buffers double in size when they run out of room.
+typedef struct {
+    GLuint vao, vbo, ebo;
+    sf_vertex_layout layout;
+    /// Ranges of the vertex buffer, in vertices.
+    sf_arena_allocator vertices;
+    /// Ranges of the index buffer, in bytes.
+    sf_arena_allocator indices;
+    /// Layout locations enabled on the vao, which follow the program its meshes were last drawn with.
+    uint32_t enabled_attribs;
+} sf_geometry_arena;
+
+/// Create an arena for a vertex layout, with room for the given number of vertices and 32-bit indices.
+EXPORT sf_geometry_arena sf_geometry_arena_new(const sf_vertex_layout *layout, size_t vertex_capacity, size_t index_capacity);
+/// Delete an arena and its buffers. Every mesh in it must be deleted first.
+EXPORT void sf_geometry_arena_delete(sf_geometry_arena *arena);
+/// Allocate count vertices in an arena, growing its vertex buffer if they don't fit.
+EXPORT sf_arena_range sf_geometry_arena_alloc_vertices(sf_geometry_arena *arena, size_t count);
+/// Allocate bytes of indices in an arena, growing its index buffer if they don't fit.
+/// The size is rounded up so every range stays aligned for 32-bit indices.
+EXPORT sf_arena_range sf_geometry_arena_alloc_indices(sf_geometry_arena *arena, size_t bytes);
+/// Get the worst fragmentation of an arena's two buffers.
+static inline float sf_geometry_arena_fragmentation(const sf_geometry_arena *arena) {
+    const float v = sf_arena_fragmentation(&arena->vertices), i = sf_arena_fragmentation(&arena->indices);
+    return v > i ? v : i;
+}
+
+#endif // ARENA_H
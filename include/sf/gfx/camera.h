@@ -27,6 +27,29 @@ typedef struct {
     sf_vec2 viewport;
 } sf_camera;
 
+/// The uniform buffer binding point camera blocks are bound to.
+#define SF_CAMERA_BINDING 0
+/// How many cameras keep their block in the uniform buffer at once. Cameras past that share the least recently used slot.
+#define SF_CAMERA_SLOTS 8
+
+/// What a camera gives to shaders, laid out like the std140 block they declare:
+///
+///     layout(std140) uniform sf_camera {
+///         mat4 c_projection;
+///         mat4 c_view;
+///         vec4 c_position;
+///         vec4 c_viewport;
+///     };
+typedef struct {
+    float projection[16], view[16];
+    float position[4], viewport[4];
+} sf_camera_block;
+
+/// The six planes bounding what a camera can see, each as (normal, distance) with the normal facing inwards.
+typedef struct {
+    vec4 planes[6];
+} sf_frustum;
+
 /// Create a new camera with its own framebuffer.
 EXPORT sf_camera sf_camera_new(sf_camera_type type, float fov, float near, float far);
 /// Delete a camera and its framebuffer.
@@ -37,4 +60,25 @@ EXPORT sf_vec3 sf_camera_right(const sf_camera *camera);
 /// Get the forward direction vector of a camera.
 EXPORT sf_vec3 sf_camera_forward(const sf_camera *camera);
 
+/// Get the matrix that moves the world in front of a camera, as passed to shaders in c_view or m_campos.
+EXPORT void sf_camera_view(mat4 out, const sf_camera *camera);
+/// Fill in the block shaders get for a camera.
+EXPORT void sf_camera_block_fill(sf_camera_block *out, const sf_camera *camera);
+/// Bind a camera's block to SF_CAMERA_BINDING, uploading it only if the camera changed since it was last bound.
+/// Blocks are kept in a uniform buffer of the current context, made the first time one is bound.
+EXPORT void sf_camera_bind_block(const sf_camera *camera);
+/// Delete the current context's uniform buffer of camera blocks, before the context is destroyed.
+EXPORT void sf_camera_blocks_free(void);
+/// Get the view volume of a camera from its projection and view matrices.
+EXPORT sf_frustum sf_camera_frustum(const sf_camera *camera);
+/// Check if any part of a sphere is inside a frustum.
+static inline bool sf_frustum_sphere(const sf_frustum *frustum, const sf_vec3 center, const float radius) {
+    for (int i = 0; i < 6; ++i) {
+        const float *p = frustum->planes[i];
+        if (p[0] * center.x + p[1] * center.y + p[2] * center.z + p[3] < -radius)
+            return false;
+    }
+    return true;
+}
+
 #endif // CAMERA_H
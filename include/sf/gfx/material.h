@@ -0,0 +1,59 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <sf/math.h>
+#include "export.h"
+#include "sf/gfx/shaders.h"
+#include "sf/gfx/textures.h"
+
+/// Texture slots a material has. The texture in slot n is bound to texture unit n.
+#define SF_MATERIAL_TEXTURES 8
+
+/// A uniform a material sets, by handle.
+typedef struct {
+    sf_uniform_id id;
+    /// GL_FLOAT, GL_INT, GL_FLOAT_VEC2, GL_FLOAT_VEC3 or GL_FLOAT_MAT4. Ints are stored bit for bit.
+    GLenum type;
+    float value[16];
+} sf_material_value;
+
+/// A shader with the uniform values and textures it draws with, resolved once and applied together.
+/// Applying the material a shader last applied, with nothing changed since, issues nothing.
+typedef struct sf_material {
+    sf_shader *shader;
+    /// The texture in each slot, or NULL, and the sampler uniform that's set to the slot's unit.
+    const sf_texture *textures[SF_MATERIAL_TEXTURES];
+    sf_uniform_id samplers[SF_MATERIAL_TEXTURES];
+    sf_material_value *values;
+    uint32_t value_count, value_capacity;
+    /// Given once and unique to the material, so draws that share it can be sorted next to each other.
+    uint32_t sort_id;
+    /// Bumped by every change, so a shader can tell the material it applied is out of date.
+    uint32_t version;
+} sf_material;
+
+/// Create a material for a shader, with no textures or uniform values.
+/// Uniform handles stay valid when the shader is reloaded, so the material does too.
+EXPORT sf_material sf_material_new(sf_shader *shader);
+/// Free a material's values. A shader that last applied it forgets it.
+EXPORT void sf_material_free(sf_material *material);
+
+/// Put a texture in a slot, and set a sampler uniform to the slot's unit. NULL empties the slot.
+/// Fails with SF_SHADER_UNKNOWN_SLOT if the slot doesn't exist, or SF_SHADER_UNKNOWN_UNIFORM if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_texture(sf_material *material, uint8_t slot, sf_str sampler, const sf_texture *texture);
+/// Set a material's float uniform by name. Fails if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_float(sf_material *material, sf_str name, float value);
+/// Set a material's int uniform by name. Fails if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_int(sf_material *material, sf_str name, int value);
+/// Set a material's vector2 uniform by name. Fails if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_vec2(sf_material *material, sf_str name, sf_vec2 value);
+/// Set a material's vector3 uniform by name. Fails if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_vec3(sf_material *material, sf_str name, sf_vec3 value);
+/// Set a material's matrix uniform by name. Fails if the shader has no such uniform.
+EXPORT sf_uniform_ex sf_material_set_mat4(sf_material *material, sf_str name, const mat4 value);
+
+/// Bind a material's shader and textures, and write its uniforms.
+/// Anything already bound or set is skipped, and so is the whole material if the shader last applied it unchanged.
+EXPORT void sf_material_apply(const sf_material *material);
+
+#endif // MATERIAL_H
@@ -1,58 +1,154 @@
 #ifndef MESHES_H
 #define MESHES_H
 
+#include <math.h>
 #include <sf/math.h>
 #include <string.h>
+#include "sf/gfx/arena.h"
 #include "sf/gfx/camera.h"
+#include "sf/gfx/material.h"
 #include "sf/gfx/shaders.h"
 #include "sf/gfx/textures.h"
+#include "sf/gfx/vertices.h"
 
 /// Camera that renders to the default framebuffer instead of its own framebuffer.
 extern const sf_camera *SF_RENDER_DEFAULT;
 static inline sf_camera sf_render_default(sf_vec2 viewport) { sf_camera c = *SF_RENDER_DEFAULT; c.viewport = viewport; return c; }
 
-/// Contains vertex data for composing a mesh.
-#pragma pack(push, 1)
+/// A half-open [start, end) range of elements inside a mesh buffer.
 typedef struct {
-    sf_vec3 position;
-    sf_vec2 uv;
-    sf_glcolor color;
-} sf_vertex;
-#pragma pack(pop)
-
-#define VEC_NAME sf_vertex_vec
-#define VEC_T sf_vertex
-#include <sf/containers/vec.h>
-#define VEC_NAME sf_index_vec
-#define VEC_T uint32_t
-#include <sf/containers/vec.h>
-#define MAP_NAME sf_index_cache
-#define MAP_K sf_vertex
-#define MAP_V uint32_t
-#define EQUAL_FN(v1, v2) (memcmp(&v1, &v2, sizeof(sf_vertex)) == 0)
-#include <sf/containers/map.h>
+    size_t start, end;
+} sf_mesh_range;
+/// Grow a range to also cover [start, end).
+static inline void sf_mesh_range_mark(sf_mesh_range *range, const size_t start, const size_t end) {
+    if (range->start >= range->end) {
+        *range = (sf_mesh_range){start, end};
+        return;
+    }
+    if (start < range->start) range->start = start;
+    if (end > range->end) range->end = end;
+}
+
+/// An axis aligned box and a sphere around every vertex of a mesh, in model space.
+typedef struct {
+    sf_vec3 min, max;
+    sf_vec3 center;
+    /// Negative while there are no vertices.
+    float radius;
+} sf_mesh_bounds;
+#define SF_MESH_BOUNDS_EMPTY ((sf_mesh_bounds){{0, 0, 0}, {0, 0, 0}, {0, 0, 0}, -1.0f})
+
+/// Grow bounds to contain a point. The sphere only grows as much as needed to reach it,
+/// so it stays close to the smallest one without knowing every point up front.
+static inline void sf_mesh_bounds_add(sf_mesh_bounds *bounds, const sf_vec3 p) {
+    if (bounds->radius < 0) {
+        *bounds = (sf_mesh_bounds){p, p, p, 0};
+        return;
+    }
+    if (p.x < bounds->min.x) bounds->min.x = p.x;
+    if (p.y < bounds->min.y) bounds->min.y = p.y;
+    if (p.z < bounds->min.z) bounds->min.z = p.z;
+    if (p.x > bounds->max.x) bounds->max.x = p.x;
+    if (p.y > bounds->max.y) bounds->max.y = p.y;
+    if (p.z > bounds->max.z) bounds->max.z = p.z;
+
+    const sf_vec3 d = {p.x - bounds->center.x, p.y - bounds->center.y, p.z - bounds->center.z};
+    const float distance = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+    if (distance > bounds->radius) {
+        const float radius = (bounds->radius + distance) * 0.5f, k = (radius - bounds->radius) / distance;
+        bounds->center = (sf_vec3){bounds->center.x + d.x * k, bounds->center.y + d.y * k, bounds->center.z + d.z * k};
+        bounds->radius = radius;
+    }
+}
+
+/// Most levels of detail a mesh can have, including the full mesh.
+#define SF_MESH_MAX_LODS 8
+/// Default screen-space error in pixels that a lower level of detail may have.
+#define SF_MESH_LOD_PIXELS 1.0f
+
+/// One level of detail: a range of a mesh's index buffer, sharing its vertices.
+typedef struct {
+    size_t offset, count;
+    /// How far the surface may have moved from the full mesh, in model units.
+    float error;
+} sf_mesh_lod;
+
+/// Programs a mesh remembers the checks of its layout against. Drawing with more checks them again as they're evicted.
+#define SF_MESH_CHECKS 4
+
+/// What checking a mesh's layout against a program found.
+typedef struct {
+    /// The sf_shader link_id of the program, or 0 if the mesh wasn't checked yet.
+    uint32_t link_id;
+    /// Whether the check counted the instance matrices as fed.
+    bool instanced;
+    /// Layout locations the program reads, which are the only ones enabled while it draws the mesh.
+    uint32_t attribs;
+    /// The first of the program's vertex inputs the layout can't feed, or SF_UNIFORM_NONE.
+    uint32_t missing;
+} sf_mesh_check;
 
 /// A bitfield containing information about an active mesh.
 typedef uint8_t sf_mesh_flags;
 #define SF_MESH_ACTIVE (sf_mesh_flags)(1 << 0)
 #define SF_MESH_VISIBLE (sf_mesh_flags)(1 << 1)
+/// The mesh only exists in vram; see sf_mesh_freeze.
+#define SF_MESH_FROZEN (sf_mesh_flags)(1 << 2)
 
 /// A mesh containing data for drawing a 3d model of any variety.
+/// Edits are only recorded as dirty ranges on the cpu, and reach vram on the next
+/// sf_mesh_update or sf_mesh_draw. GPU buffers grow geometrically to fit.
+/// Indices are 16-bit until the mesh has more than 65536 vertices.
+/// Levels of detail are stored after the full mesh in the same index buffer.
 typedef struct {
     GLuint vao, vbo, ebo;
-    sf_vertex_vec vertices;
-    sf_index_vec indices;
-    sf_index_cache cache;
+    sf_vertex_layout layout;
+    sf_vertex_data vertices;
+    sf_index_data indices;
+    sf_vertex_table cache;
     sf_mesh_flags flags;
+
+    size_t vbo_capacity, ebo_capacity;
+    sf_mesh_range dirty_vertices, dirty_indices;
+    /// Kept up to date as vertices are added, and used for culling and level of detail selection.
+    sf_mesh_bounds bounds;
+
+    sf_mesh_lod lods[SF_MESH_MAX_LODS];
+    uint8_t lod_count;
+    /// Largest projected error in pixels a level of detail is drawn with.
+    float lod_pixels;
+
+    /// The file a loaded mesh's vertices and indices still point into, until it is first edited.
+    void *mapping;
+    size_t mapping_size;
+
+    /// Layout locations enabled on the mesh's own vao. Meshes in an arena use the arena's.
+    uint32_t enabled_attribs;
+    /// The programs the mesh was last drawn with, and the slot the next new one replaces.
+    sf_mesh_check checks[SF_MESH_CHECKS];
+    uint8_t next_check;
+
+    /// Per-instance model matrices, created on the first instanced draw.
+    GLuint instance_vbo;
+    size_t instance_capacity;
+
+    /// The arena the mesh's vertices and indices live in, or NULL if it has buffers of its own.
+    sf_geometry_arena *arena;
+    /// Where the mesh lives in its arena's buffers: vertices in vertices, indices in bytes.
+    /// Both start at 0 for meshes with their own buffers.
+    sf_arena_range vertex_range, index_range;
 } sf_mesh;
 
 typedef struct {
     enum {
         SF_DRAW_SHADER_MISSING,
         SF_DRAW_UNKNOWN_UNIFORM,
+        /// The shader reads a vertex input the mesh's layout doesn't have, or reads it as integers.
+        SF_DRAW_ATTRIB_MISMATCH,
     } type;
     union {
         sf_str uniform_name;
+        sf_str attrib_name;
     } value;
 } sf_draw_err;
 
@@ -60,21 +156,219 @@ typedef struct {
 #define EXPECTED_E sf_draw_err
 #include <sf/containers/expected.h>
 
-/// Create a new, empty mesh.
+/// Why a mesh file couldn't be saved or loaded.
+typedef enum {
+    SF_MESH_FILE_NOT_FOUND,
+    SF_MESH_FILE_READ_FAILURE,
+    SF_MESH_FILE_WRITE_FAILURE,
+    /// The file isn't a mesh file, is truncated, or has an index past its vertices.
+    SF_MESH_FILE_INVALID,
+    /// The file was written by a different version of the format.
+    SF_MESH_FILE_WRONG_VERSION,
+    /// The file was written on a machine of the other byte order.
+    SF_MESH_FILE_WRONG_BYTE_ORDER,
+    /// The mesh was frozen, so there is nothing on the cpu to save.
+    SF_MESH_FILE_FROZEN,
+} sf_mesh_file_err;
+
+#define EXPECTED_NAME sf_mesh_file_ex
+#define EXPECTED_O sf_mesh
+#define EXPECTED_E sf_mesh_file_err
+#include <sf/containers/expected.h>
+
+#define EXPECTED_NAME sf_mesh_save_ex
+#define EXPECTED_E sf_mesh_file_err
+#include <sf/containers/expected.h>
+
+/// Why a mesh couldn't be edited.
+typedef enum {
+    /// The mesh was frozen, and its cpu data released.
+    SF_MESH_EDIT_FROZEN,
+    /// The mesh's layout has no attributes, so its vertices have nothing to store.
+    SF_MESH_EDIT_NO_ATTRIBS,
+} sf_mesh_err;
+
+#define EXPECTED_NAME sf_mesh_ex
+#define EXPECTED_E sf_mesh_err
+#include <sf/containers/expected.h>
+
+/// Create a new, empty mesh that stores full float vertices.
 EXPORT sf_mesh sf_mesh_new(void);
-/// Free a mesh and delete all of its vertices.
+/// Create a new, empty mesh that stores its vertices in a predefined format.
+EXPORT sf_mesh sf_mesh_new_format(sf_vertex_format format);
+/// Create a new, empty mesh with any vertex layout.
+/// Only the attributes in the layout are stored and streamed to the gpu; without any, the mesh takes no vertices.
+EXPORT sf_mesh sf_mesh_new_layout(const sf_vertex_layout *layout);
+/// Create a new, empty mesh whose vertices and indices are stored in a shared arena, with the arena's layout.
+/// The arena must outlive the mesh.
+EXPORT sf_mesh sf_mesh_new_arena(sf_geometry_arena *arena);
+/// Free a mesh and delete all of its vertices. Meshes in an arena give their ranges back to it.
 EXPORT void sf_mesh_delete(sf_mesh *mesh);
+/// Get the vao a mesh is drawn with.
+static inline GLuint sf_mesh_vao(const sf_mesh *mesh) { return mesh->arena ? mesh->arena->vao : mesh->vao; }
+/// Move every mesh of an arena to the start of its buffers, closing the holes between them.
+/// meshes must hold every live mesh in the arena; their data is copied on the gpu, so frozen meshes move too.
+EXPORT void sf_geometry_arena_compact(sf_geometry_arena *arena, sf_mesh *const *meshes, size_t count);
+
+/// Identifies a mesh file, "SFMS" when written on a little endian machine.
+#define SF_MESH_FILE_MAGIC 0x534D4653u
+/// The magic as read from a file written on a machine of the other byte order.
+#define SF_MESH_FILE_MAGIC_SWAPPED 0x53464D53u
+/// Bumped whenever the layout of a mesh file changes. Older files are rejected, not converted.
+#define SF_MESH_FILE_VERSION 1
+/// Alignment of every blob in a mesh file, relative to the start of the file.
+#define SF_MESH_FILE_ALIGN 64
 
-/// Copy a mesh to vram (Vertex Buffer)
-EXPORT void sf_mesh_update(const sf_mesh *mesh);
+/// An attribute of a mesh file's vertex layout.
+typedef struct {
+    uint32_t location, components, type, normalized, offset;
+} sf_mesh_file_attrib;
+/// A level of detail in a mesh file, in indices.
+typedef struct {
+    uint64_t offset, count;
+    float error;
+    uint32_t padding;
+} sf_mesh_file_lod;
+/// The header at the start of a mesh file. Every field is in the writing machine's native byte order and naturally aligned;
+/// files are only read back on machines of the same order.
+/// The vertex and index blobs follow it, each starting on an SF_MESH_FILE_ALIGN boundary.
+typedef struct {
+    uint32_t magic, version;
+    uint32_t format, stride, attrib_count, index_type;
+    sf_mesh_file_attrib attribs[SF_VERTEX_MAX_ATTRIBS];
+    uint64_t vertex_offset, vertex_count;
+    uint64_t index_offset, index_count;
+    uint32_t lod_count, padding;
+    sf_mesh_file_lod lods[SF_MESH_MAX_LODS];
+    float min[3], max[3];
+    float center[3], radius;
+    uint32_t reserved[2];
+} sf_mesh_file_header;
+
+/// Write a mesh, its layout and its levels of detail to a file that sf_mesh_load_mapped can map straight back.
+EXPORT sf_mesh_save_ex sf_mesh_save(const sf_mesh *mesh, sf_str path);
+/// Map a mesh file into memory and upload it to the gpu as is, without deduplicating anything.
+/// The mesh reads its vertices and indices from the mapping until it is first edited.
+EXPORT sf_mesh_file_ex sf_mesh_load_mapped(sf_str path);
+static inline sf_mesh_file_ex sf_mesh_cload_mapped(const char *path) { return sf_mesh_load_mapped(sf_ref(path)); }
+/// Copy a mapped mesh's data into memory it owns, and rebuild its deduplication table.
+/// Every function that edits a mesh does this first, so it rarely needs calling by hand.
+EXPORT void sf_mesh_own(sf_mesh *mesh);
+
+/// Copy a mesh's pending changes to vram (Vertex Buffer).
+/// Only dirty ranges are uploaded, unless the buffers had to grow.
+EXPORT void sf_mesh_update(sf_mesh *mesh);
+/// Check if a mesh has changes that haven't been uploaded yet.
+static inline bool sf_mesh_dirty(const sf_mesh *mesh) {
+    return mesh->dirty_vertices.start < mesh->dirty_vertices.end
+        || mesh->dirty_indices.start < mesh->dirty_indices.end;
+}
 /// Add a single vertex to a mesh's model.
-EXPORT void sf_mesh_add_vertex(sf_mesh *mesh, sf_vertex vertex);
+EXPORT sf_mesh_ex sf_mesh_add_vertex(sf_mesh *mesh, sf_vertex vertex);
 /// Add an array of vertices to a mesh's model.
-EXPORT void sf_mesh_add_vertices(sf_mesh *mesh, const sf_vertex *vertices, size_t count);
+/// The deduplication table is sized for count new vertices up front.
+EXPORT sf_mesh_ex sf_mesh_add_vertices(sf_mesh *mesh, const sf_vertex *vertices, size_t count);
+/// Add an array of vertices that are already in the mesh's layout.
+/// This is the only way to fill attributes sf_vertex doesn't have, like normals.
+EXPORT sf_mesh_ex sf_mesh_add_raw(sf_mesh *mesh, const void *vertices, size_t count);
+/// Add an array of vertices to a mesh's model, deduplicating them on several threads.
+/// The result is identical to sf_mesh_add_vertices; small batches are added serially.
+EXPORT sf_mesh_ex sf_mesh_add_vertices_parallel(sf_mesh *mesh, const sf_vertex *vertices, size_t count, uint32_t threads);
+
+/// Upload a mesh, then release its vertices, indices and deduplication table on the cpu.
+/// Counts, bounds, levels of detail and gpu buffers are kept, so it still draws, but it can't be edited,
+/// optimized or saved anymore.
+EXPORT void sf_mesh_freeze(sf_mesh *mesh);
+
+/// Size of the FIFO cache that sf_mesh_optimize reports statistics for, about that of current GPUs.
+#define SF_MESH_CACHE_SIZE 16
+
+/// How well an index order uses the gpu's post-transform vertex cache.
+typedef struct {
+    /// Average cache miss ratio: vertices transformed per triangle. 0.5 is ideal, 3 is the worst.
+    float acmr;
+    /// Average transform to vertex ratio: times each used vertex is transformed. 1 is ideal.
+    float atvr;
+} sf_mesh_cache_stats;
+
+/// Cache statistics of a mesh before and after sf_mesh_optimize.
+typedef struct {
+    sf_mesh_cache_stats before, after;
+} sf_mesh_optimize_report;
+
+/// Options for sf_mesh_optimize.
+typedef uint8_t sf_optimize_flags;
+/// Also sort clusters of triangles to reduce overdraw, at a slight cost to the vertex cache.
+#define SF_OPTIMIZE_OVERDRAW (sf_optimize_flags)(1 << 0)
+
+/// Simulate a FIFO vertex cache of cache_size entries over a list of triangles.
+EXPORT sf_mesh_cache_stats sf_index_cache_stats(const uint32_t *indices, size_t index_count, size_t vertex_count, uint32_t cache_size);
+/// Simulate a FIFO vertex cache of cache_size entries over a mesh's triangles.
+EXPORT sf_mesh_cache_stats sf_mesh_cache_stats_get(const sf_mesh *mesh, uint32_t cache_size);
+/// Reorder a mesh's triangles for the vertex cache, and its vertices for fetch locality.
+/// Indices are remapped and the deduplication table rebuilt, so vertices can still be added afterwards.
+/// The whole mesh is uploaded again on the next update. Frozen meshes are left alone.
+EXPORT sf_mesh_optimize_report sf_mesh_optimize(sf_mesh *mesh, sf_optimize_flags flags);
+
+/// Simplify a list of triangles to about target_count indices by collapsing edges, cheapest first by quadric error.
+/// Vertices are never moved or created, so the result uses the same vertices. Seams and open borders are kept.
+/// out must have room for index_count indices; returns how many were written. error is set to how far the
+/// surface moved, in the units of positions.
+EXPORT size_t sf_index_simplify(uint32_t *out, const uint32_t *indices, size_t index_count, const sf_vec3 *positions,
+                                size_t vertex_count, size_t target_count, float *error);
+/// Reorder a list of triangles for the vertex cache in place.
+EXPORT void sf_index_optimize_cache(uint32_t *indices, size_t index_count, size_t vertex_count);
+
+/// Generate up to levels levels of detail for a mesh, including the full mesh, each with about ratio
+/// times the triangles of the one before. Returns how many levels the mesh ends up with.
+/// Levels are discarded when vertices are added, or the mesh is optimized. Frozen meshes are left alone.
+EXPORT size_t sf_mesh_generate_lods(sf_mesh *mesh, uint8_t levels, float ratio);
+/// Remove a mesh's levels of detail, keeping the full mesh.
+static inline void sf_mesh_lod_clear(sf_mesh *mesh) {
+    if (mesh->lod_count == 0)
+        return;
+    mesh->indices.count = mesh->lods[0].count;
+    mesh->lod_count = 0;
+}
+/// Pick the coarsest level of detail whose error projects to at most lod_pixels on a camera's viewport.
+EXPORT uint8_t sf_mesh_lod_select(const sf_mesh *mesh, const sf_camera *camera, sf_transform transform);
+/// Pick a level of detail like sf_mesh_lod_select, for a mesh placed by a model matrix.
+EXPORT uint8_t sf_mesh_lod_model(const sf_mesh *mesh, const sf_camera *camera, mat4 model);
+
+/// Check if a mesh's bounds, placed by a model matrix, are at least partly inside a frustum.
+EXPORT bool sf_mesh_in_view(const sf_mesh *mesh, const sf_frustum *frustum, mat4 model);
+
+/// Get the draw counters of the current context.
+EXPORT sf_draw_stats sf_draw_stats_get(void);
+/// Reset the draw counters of the current context to zero.
+EXPORT void sf_draw_stats_reset(void);
+/// Add to the current context's draw counters, for anything that draws meshes without sf_mesh_draw.
+EXPORT void sf_draw_stats_count(size_t drawn, size_t culled);
+
+/// Get the byte offset of one of a mesh's indices in the buffer it is drawn from, as passed to glDrawElements.
+static inline const void *sf_mesh_index_offset(const sf_mesh *mesh, const size_t index) {
+    return (const void*)(uintptr_t)(mesh->index_range.offset + index * sf_index_size(mesh->indices.type));
+}
+/// Give a bound shader a camera: its sf_camera block if it declares one, otherwise the m_projection and m_campos uniforms.
+EXPORT sf_draw_ex sf_mesh_camera_uniforms(sf_shader *shader, const sf_camera *camera);
 
+/// Bind a mesh's vao to draw it with a shader, checking once per program that the layout feeds every vertex input it reads.
+/// Attributes the program doesn't read are disabled, so they aren't fetched. Instanced draws also feed SF_ATTRIB_INSTANCE.
+EXPORT sf_draw_ex sf_mesh_bind(sf_mesh *mesh, const sf_shader *shader, bool instanced);
 
 /// Draw a mesh to the framebuffer of the specified camera.
 /// To draw to the default framebuffer, pass SF_RENDER_DEFAULT.
-EXPORT sf_draw_ex sf_mesh_draw(const sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, sf_transform transform, const sf_texture *texture);
+/// Meshes whose bounds are outside the camera's view are skipped.
+/// Pending changes are uploaded first, and the level of detail is picked by the distance to the camera.
+EXPORT sf_draw_ex sf_mesh_draw(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, sf_transform transform, const sf_texture *texture);
+/// Draw a mesh like sf_mesh_draw, with a material's shader, textures and uniforms instead of a shader and one texture.
+EXPORT sf_draw_ex sf_mesh_draw_material(sf_mesh *mesh, const sf_material *material, const sf_camera *camera, sf_transform transform);
+/// Draw count copies of a mesh in as few draw calls as possible, one per level of detail in use.
+/// Model matrices are streamed to the shader as a per-instance mat4 at SF_ATTRIB_INSTANCE instead of m_model.
+/// Instances outside the camera's view are skipped, and each one picks its own level of detail.
+EXPORT sf_draw_ex sf_mesh_draw_instanced(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform *transforms, size_t count, const sf_texture *texture);
+/// Draw count copies of a mesh like sf_mesh_draw_instanced, from model matrices that are already computed.
+/// The matrices aren't modified.
+EXPORT sf_draw_ex sf_mesh_draw_matrices(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, mat4 *models, size_t count, const sf_texture *texture);
 
 #endif // MESHES_H
@@ -0,0 +1,69 @@
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include "export.h"
+#include "sf/gfx/meshes.h"
+
+/// Bits of a render key given to each part, from the most significant.
+/// Handles are truncated to fit, which only makes sorting less effective, never wrong.
+#define SF_RENDER_KEY_TARGET_BITS  8
+#define SF_RENDER_KEY_SHADER_BITS  12
+#define SF_RENDER_KEY_TEXTURE_BITS 12
+#define SF_RENDER_KEY_MESH_BITS    12
+#define SF_RENDER_KEY_DEPTH_BITS   20
+
+/// Build the key a draw is sorted by: framebuffer, then program, texture and vao, then front to back.
+/// Draws with a material pass its sort_id as the texture, so draws that share one end up together.
+/// depth is the distance to the camera over its far plane, clamped to 0..1.
+static inline uint64_t sf_render_key(const GLuint target, const GLuint program, const GLuint texture, const GLuint vao, float depth) {
+    depth = depth < 0.0f ? 0.0f : depth > 1.0f ? 1.0f : depth;
+    uint64_t key = target & ((1u << SF_RENDER_KEY_TARGET_BITS) - 1);
+    key = key << SF_RENDER_KEY_SHADER_BITS | (program & ((1u << SF_RENDER_KEY_SHADER_BITS) - 1));
+    key = key << SF_RENDER_KEY_TEXTURE_BITS | (texture & ((1u << SF_RENDER_KEY_TEXTURE_BITS) - 1));
+    key = key << SF_RENDER_KEY_MESH_BITS | (vao & ((1u << SF_RENDER_KEY_MESH_BITS) - 1));
+    return key << SF_RENDER_KEY_DEPTH_BITS | (uint64_t)(depth * (float)((1u << SF_RENDER_KEY_DEPTH_BITS) - 1));
+}
+
+/// A draw waiting in a render queue.
+typedef struct {
+    sf_mesh *mesh;
+    sf_shader *shader;
+    const sf_camera *camera;
+    /// The draw's texture, or its material if it has one instead.
+    const sf_texture *texture;
+    const sf_material *material;
+    float model[16];
+    uint8_t lod;
+} sf_render_cmd;
+
+/// A sort key and the draw it belongs to.
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} sf_render_item;
+
+/// Draws collected over a frame, to be sorted by key and drawn together.
+/// Consecutive draws that share a framebuffer, program, texture or vao don't bind it again,
+/// and a program only gets its camera uniforms again when the camera changes.
+typedef struct {
+    sf_render_cmd *cmds;
+    sf_render_item *items, *scratch;
+    size_t count, capacity;
+} sf_render_queue;
+
+/// Create a new, empty render queue.
+EXPORT sf_render_queue sf_render_queue_new(void);
+/// Free a render queue and its draws.
+EXPORT void sf_render_queue_free(sf_render_queue *queue);
+/// Queue a draw of a mesh, like sf_mesh_draw. Meshes outside the camera's view are culled right away.
+/// The mesh, shader, camera and texture are only used when the queue is flushed, so they must live until then.
+EXPORT void sf_render_queue_push(sf_render_queue *queue, sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, sf_transform transform, const sf_texture *texture);
+/// Queue a draw of a mesh with a material, like sf_mesh_draw_material. The material must live until the queue is flushed.
+EXPORT void sf_render_queue_push_material(sf_render_queue *queue, sf_mesh *mesh, const sf_material *material, const sf_camera *camera, sf_transform transform);
+/// Sort a queue's draws by key with a stable radix sort, skipping bytes every key shares.
+EXPORT void sf_render_queue_sort(sf_render_queue *queue);
+/// Sort and draw everything in a queue, then empty it.
+/// A draw that fails is skipped and the rest still draw. Returns the first failure, if any.
+EXPORT sf_draw_ex sf_render_queue_flush(sf_render_queue *queue);
+
+#endif // QUEUE_H
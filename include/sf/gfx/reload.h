@@ -0,0 +1,34 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <sf/math.h>
+#include "export.h"
+#include "sf/gfx/shaders.h"
+#include "sf/gfx/textures.h"
+
+/// Watches the files of shaders and textures, and reloads them when they change on disk.
+/// Files are read, expanded and decoded on a background thread. Programs are compiled without waiting for the driver,
+/// and swapped in by sf_reloader_apply once they're done, so a frame never stalls on a reload.
+/// A shader that fails to compile keeps its old program. Only supported on Linux, through inotify.
+typedef struct sf_reloader sf_reloader;
+
+/// Start watching for changes on a background thread.
+/// Returns NULL if files can't be watched on this platform or the watcher can't be started.
+EXPORT sf_reloader *sf_reloader_new(void);
+/// Stop watching and free a reloader. Shaders still compiling are dropped.
+EXPORT void sf_reloader_free(sf_reloader *reloader);
+/// Reload a shader when its .vert or .frag file, or a .glsl file in their directory it may include, changes.
+/// The shader must live until it's forgotten or the reloader is freed. Its variants aren't reloaded.
+/// Returns false if its directory can't be watched.
+EXPORT bool sf_reloader_watch_shader(sf_reloader *reloader, sf_shader *shader);
+/// Reload a texture when the file it was loaded from changes.
+/// The texture must live until it's forgotten or the reloader is freed.
+/// Returns false if it wasn't loaded from a file, or its directory can't be watched.
+EXPORT bool sf_reloader_watch_texture(sf_reloader *reloader, sf_texture *texture);
+/// Stop watching a shader or texture, dropping any reload in progress.
+EXPORT void sf_reloader_forget(sf_reloader *reloader, const void *asset);
+/// Swap in the shaders and textures that finished reloading, and start compiling the ones that were read.
+/// Call it between frames, from the thread that owns the context. Returns how many assets were swapped.
+EXPORT size_t sf_reloader_apply(sf_reloader *reloader);
+
+#endif // RELOAD_H
@@ -5,20 +5,91 @@
 #include <cglm/cglm.h>
 #include <sf/str.h>
 #include "export.h"
+#include "sf/gfx/state.h"
+
+/// A handle to one of a shader's uniforms, resolved once by name and then used to set it directly.
+typedef uint32_t sf_uniform_id;
+/// The handle of a uniform a shader doesn't have. Setting it always fails.
+#define SF_UNIFORM_NONE UINT32_MAX
 
 #define MAP_NAME sf_uniform_map
 #define MAP_K sf_str
-#define MAP_V GLint
+#define MAP_V sf_uniform_id
 #define HASH_FN sf_str_hash
 #define EQUAL_FN sf_str_eq
 #include <sf/containers/map.h>
 
+/// An active uniform of a linked program.
+typedef struct {
+    sf_str name;
+    GLint location;
+    GLenum type;
+    GLint size;
+    /// The last value written to the uniform, if any, so writing it again can be skipped.
+    float value[16];
+    bool known;
+    /// Whether a material sets it, so writing it some other way makes the shader forget the material it applied.
+    bool material;
+} sf_uniform_info;
+
+/// An active vertex input of a linked program. Built-in inputs like gl_VertexID aren't included.
+typedef struct {
+    sf_str name;
+    GLint location;
+    GLenum type;
+    GLint size;
+} sf_attrib_info;
+
+/// Get how many consecutive locations a vertex input of a type takes, one per matrix column.
+static inline uint32_t sf_attrib_columns(const GLenum type) {
+    switch (type) {
+        case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4: return 2;
+        case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4: return 3;
+        case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3: return 4;
+        default: return 1;
+    }
+}
+/// Check if a vertex input reads floats, which is all glVertexAttribPointer can feed it.
+static inline bool sf_attrib_float(const GLenum type) {
+    switch (type) {
+        case GL_FLOAT: case GL_FLOAT_VEC2: case GL_FLOAT_VEC3: case GL_FLOAT_VEC4:
+        case GL_FLOAT_MAT2: case GL_FLOAT_MAT2x3: case GL_FLOAT_MAT2x4:
+        case GL_FLOAT_MAT3: case GL_FLOAT_MAT3x2: case GL_FLOAT_MAT3x4:
+        case GL_FLOAT_MAT4: case GL_FLOAT_MAT4x2: case GL_FLOAT_MAT4x3: return true;
+        default: return false;
+    }
+}
+
 /// An OpenGL shader program and its vertex/fragment glsl shaders.
-/// Uniform locations are automatically cached as you use them.
+/// Its active uniforms and vertex inputs are read once it's linked, and uniforms can be set by name or by handle.
 typedef struct {
     sf_str path;
     GLuint program;
+    /// Unique to each program linked or loaded, so checks cached against it can't mistake a reused program name for it.
+    uint32_t link_id;
+    /// Every active uniform outside of a block, indexed by handle. Arrays are named without their [0], and their other elements are added as they're looked up.
+    sf_uniform_info *uniform_info;
+    uint32_t uniform_count;
+    /// Uniform names to their handles.
     sf_uniform_map uniforms;
+    /// Every active vertex input, and a bit for each location below 32 they read.
+    sf_attrib_info *attrib_info;
+    uint32_t attrib_count;
+    uint32_t attrib_locations;
+    /// Handles of the uniforms sepgfx sets itself when drawing.
+    sf_uniform_id u_model, u_sampler, u_projection, u_campos;
+    /// Whether the program declares the sf_camera uniform block, which is then bound to SF_CAMERA_BINDING.
+    bool camera_block;
+    /// Whether the program is still compiling and linking. Its uniforms aren't known until sf_shader_ready says it's done.
+    bool pending;
+    /// The stages of a pending program, or 0 if it came from the program cache, and the key to cache it under.
+    GLuint stages[2];
+    uint64_t cache_key;
+    /// Variants compiled from the same files with other defines.
+    struct sf_shader_variants *variants;
+    /// The material last applied to the program, and its version then. See sf_material_apply.
+    const struct sf_material *material;
+    uint32_t material_version;
 } sf_shader;
 
 typedef struct {
@@ -27,6 +98,8 @@ typedef struct {
         SF_SHADER_COMPILE_ERROR,
 
         SF_SHADER_UNKNOWN_UNIFORM,
+        /// A material has no texture slot at that index.
+        SF_SHADER_UNKNOWN_SLOT,
     } type;
     sf_str compile_err;
 } sf_shader_err;
@@ -36,6 +109,35 @@ typedef struct {
 #define EXPECTED_E sf_shader_err
 #include <sf/containers/expected.h>
 
+#define EXPECTED_NAME sf_source_ex
+#define EXPECTED_O char *
+#define EXPECTED_E sf_shader_err
+#include <sf/containers/expected.h>
+
+/// A file compiled into the program by the sepgfx_embed_shaders CMake function.
+typedef struct {
+    const char *path;
+    const char *source;
+    size_t size;
+} sf_shader_file;
+
+/// Make embedded files take the place of the files at their paths, for shaders and their includes.
+/// The table must live as long as shaders are loaded, which generated tables do.
+EXPORT void sf_shader_embed(const sf_shader_file *files, size_t count);
+
+/// How deep #include can nest, which also stops include cycles.
+#define SF_SHADER_INCLUDE_DEPTH 16
+
+/// Expand a glsl source: replace every #include "file" line with the file, found relative to dir,
+/// and put the defines right after the #version line. defines can be NULL.
+/// A file is only included the first time it's named, and includes in block comments are left alone.
+/// Returns the expanded source, to be freed with free.
+EXPORT sf_source_ex sf_shader_preprocess(const char *source, sf_str dir, const char *defines);
+/// Read a glsl file, or the embedded file at its path, and expand it with sf_shader_preprocess, resolving includes relative to it.
+EXPORT sf_source_ex sf_shader_source(sf_str path, const char *defines);
+/// Read and expand a glsl file like sf_shader_source, but only from disk, to see changes to files that are also embedded.
+EXPORT sf_source_ex sf_shader_source_disk(sf_str path, const char *defines);
+
 /// Compile and link shaders into a program.
 /// Returns a result if it fails.
 EXPORT sf_shader_ex sf_shader_new(sf_str path);
@@ -43,13 +145,84 @@ EXPORT sf_shader_ex sf_shader_new(sf_str path);
 /// Cached uniforms will be reset.
 EXPORT void sf_shader_free(sf_shader *shader);
 
+#define EXPECTED_NAME sf_ready_ex
+#define EXPECTED_O bool
+#define EXPECTED_E sf_shader_err
+#include <sf/containers/expected.h>
+
+#define EXPECTED_NAME sf_variant_ex
+#define EXPECTED_O sf_shader *
+#define EXPECTED_E sf_shader_err
+#include <sf/containers/expected.h>
+
+/// Get a variant of a shader, compiled from its files with a set of defines like "SKINNED" or "LIGHTS=4".
+/// Each set is compiled once, in whatever order its defines come, and the variant is kept until the shader is freed.
+EXPORT sf_variant_ex sf_shader_variant(sf_shader *shader, const sf_str *defines, size_t count);
+/// Get the #define lines sf_shader_variant compiles a set of defines with, sorted and without repeats.
+/// Sets that make the same text make the same variant.
+EXPORT sf_str sf_shader_variant_defines(const sf_str *defines, size_t count);
+
+/// Compile and link shaders into a program from sources in memory, like sf_shader_new.
+/// Includes are resolved relative to path, in the embedded files first. Variants need the files embedded or on disk.
+EXPORT sf_shader_ex sf_shader_from_memory(sf_str path, const char *vertex_source, const char *fragment_source);
+/// Start compiling shaders from sources in memory without waiting for the driver, like sf_shader_new_async.
+EXPORT sf_shader_ex sf_shader_from_memory_async(sf_str path, const char *vertex_source, const char *fragment_source);
+/// Move a ready shader's program into another shader, freeing its old program and keeping its path and variants.
+/// Uniform handles resolved for the old program stay valid, and uniforms it no longer has are ignored.
+EXPORT void sf_shader_replace(sf_shader *shader, sf_shader *with);
+
+/// Start compiling and linking shaders into a program without waiting for the driver.
+/// Returns a result if a source can't be read. Compile errors are returned by sf_shader_ready.
+EXPORT sf_shader_ex sf_shader_new_async(sf_str path);
+/// Start compiling a batch of shaders, one result per path, so the driver can work on all of them at once.
+EXPORT void sf_shader_new_batch(const sf_str *paths, size_t count, sf_shader_ex *out);
+/// Check if a shader from sf_shader_new_async has finished, without stalling if the driver has GL_KHR_parallel_shader_compile.
+/// Returns true once it can be used, or the compile error, after which it should only be freed with sf_shader_free.
+/// Without the extension, the first call waits for the driver.
+EXPORT sf_ready_ex sf_shader_ready(sf_shader *shader);
+/// glMaxShaderCompilerThreadsKHR or its ARB twin, with the GL calling convention.
+typedef void (APIENTRY *sf_max_threads_proc)(GLuint count);
+/// Let the driver compile shaders on its own threads if it has GL_KHR_parallel_shader_compile. Called by sf_window_new.
+/// max_threads is the extension's glMaxShaderCompilerThreadsKHR or glMaxShaderCompilerThreadsARB, or NULL if neither could be loaded.
+EXPORT void sf_shader_parallel_init(sf_max_threads_proc max_threads);
+
+/// The key of a program that isn't cached, because the program cache is off.
+#define SF_SHADER_CACHE_OFF 0
+
+/// Cache linked programs as driver binaries in a directory, so later runs load them instead of compiling.
+/// Off by default. SF_STR_EMPTY turns it back off.
+EXPORT void sf_shader_cache_dir(sf_str dir);
+/// Get the key a program is cached by: its sources along with the driver's vendor, renderer and version.
+/// Returns SF_SHADER_CACHE_OFF if the cache is off.
+EXPORT uint64_t sf_shader_cache_key(const char *vertex_source, const char *fragment_source);
+/// Create a program from the binary cached under a key.
+/// Returns 0 if there is none, or if the driver rejects it and the program has to be compiled from source.
+EXPORT GLuint sf_shader_cache_load(uint64_t key);
+/// Save the binary of a linked program under a key. It must be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+/// Returns false if it couldn't be written.
+EXPORT bool sf_shader_cache_store(uint64_t key, GLuint program);
+
 /// Bind to the shader's OpenGL program.
-static inline void sf_shader_bind(const sf_shader *shader) { glUseProgram(shader->program); }
+static inline void sf_shader_bind(const sf_shader *shader) { sf_gl_use_program(shader->program); }
 
 #define EXPECTED_NAME sf_uniform_ex
 #define EXPECTED_E sf_shader_err
 #include <sf/containers/expected.h>
 
+/// Get the handle of a shader's uniform by name, or SF_UNIFORM_NONE if it has no such active uniform.
+/// Array elements are named like in GLSL, "lights[2]"; "lights[0]" is the same uniform as "lights".
+EXPORT sf_uniform_id sf_shader_uniform_id(sf_shader *shader, sf_str name);
+/// Set a shader's float uniform by handle.
+EXPORT sf_uniform_ex sf_shader_set_float(sf_shader *shader, sf_uniform_id id, float value);
+/// Set a shader's int uniform by handle.
+EXPORT sf_uniform_ex sf_shader_set_int(sf_shader *shader, sf_uniform_id id, int value);
+/// Set a shader's vector2 uniform by handle.
+EXPORT sf_uniform_ex sf_shader_set_vec2(sf_shader *shader, sf_uniform_id id, sf_vec2 value);
+/// Set a shader's vector3 uniform by handle.
+EXPORT sf_uniform_ex sf_shader_set_vec3(sf_shader *shader, sf_uniform_id id, sf_vec3 value);
+/// Set a shader's matrix uniform by handle.
+EXPORT sf_uniform_ex sf_shader_set_mat4(sf_shader *shader, sf_uniform_id id, const mat4 value);
+
 /// Set a shader's float uniform to the desired value by name.
 /// Returns true on success.
 EXPORT sf_uniform_ex sf_shader_uniform_float(sf_shader *shader, sf_str name, float value);
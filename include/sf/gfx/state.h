@@ -0,0 +1,186 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <glad/glad.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "export.h"
+
+/// Marks a binding the cache doesn't know, so the next call goes through.
+#define SF_GL_UNKNOWN UINT32_MAX
+/// Texture units whose bindings are cached. Binds to higher units always go through.
+#define SF_GL_TEXTURE_UNITS 16
+/// Uniform buffer binding points whose ranges are cached. Higher binding points always go through.
+#define SF_GL_UNIFORM_BINDINGS 4
+
+/// How many state changes reached the driver, and how many were dropped for already being set.
+/// Uniform uploads are counted apart, and are skipped when they'd write the value a uniform already has.
+typedef struct {
+    size_t issued, skipped;
+    size_t uniforms_issued, uniforms_skipped;
+} sf_gl_counters;
+
+/// Counters for the meshes drawn since the last sf_draw_stats_reset.
+typedef struct {
+    size_t drawn, culled;
+} sf_draw_stats;
+
+/// A range of a buffer bound to an indexed binding point.
+typedef struct {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+} sf_gl_range;
+
+/// A shadow copy of the OpenGL state sepgfx changes, for one context.
+/// Every entry point sets state through the sf_gl_ functions below, which skip calls that wouldn't change anything.
+/// Call sf_gl_state_invalidate after changing any of it with raw OpenGL calls.
+typedef struct {
+    GLuint program, vao;
+    GLuint array_buffer, element_buffer, copy_read_buffer, copy_write_buffer;
+    GLuint framebuffer;
+    GLuint active_texture;
+    GLuint textures[SF_GL_TEXTURE_UNITS];
+    sf_gl_range uniform_ranges[SF_GL_UNIFORM_BINDINGS];
+    GLint viewport[4];
+    /// 1 if enabled, 0 if disabled, -1 if unknown.
+    int8_t depth_test, blend;
+    sf_gl_counters counters;
+    /// Meshes drawn and culled in the context, read and reset through sf_draw_stats_get and sf_draw_stats_reset.
+    sf_draw_stats draws;
+    /// The context's uniform buffer of camera blocks, made by sf_camera_bind_block and freed by sf_camera_blocks_free.
+    struct sf_camera_blocks *camera_blocks;
+} sf_gl_state;
+
+/// A state cache that knows nothing yet, for a context that was just created or changed behind its back.
+#define SF_GL_STATE_UNKNOWN { \
+    .program = SF_GL_UNKNOWN, .vao = SF_GL_UNKNOWN, \
+    .array_buffer = SF_GL_UNKNOWN, .element_buffer = SF_GL_UNKNOWN, \
+    .copy_read_buffer = SF_GL_UNKNOWN, .copy_write_buffer = SF_GL_UNKNOWN, \
+    .framebuffer = SF_GL_UNKNOWN, .active_texture = SF_GL_UNKNOWN, \
+    .textures = { \
+        SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, \
+        SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, SF_GL_UNKNOWN, \
+    }, \
+    .uniform_ranges = {{SF_GL_UNKNOWN, 0, 0}, {SF_GL_UNKNOWN, 0, 0}, {SF_GL_UNKNOWN, 0, 0}, {SF_GL_UNKNOWN, 0, 0}}, \
+    .viewport = {-1, -1, -1, -1}, \
+    .depth_test = -1, .blend = -1, \
+}
+
+/// The state cache of the current context.
+extern sf_gl_state *sf_gl_current;
+
+/// Forget everything a state cache knows, keeping its counters and camera blocks.
+EXPORT void sf_gl_state_invalidate(sf_gl_state *state);
+/// Make a state cache the current one, after its context was made current.
+/// NULL goes back to a cache that knows nothing, for when the current context is destroyed.
+EXPORT void sf_gl_state_use(sf_gl_state *state);
+
+/// Count a call as issued if the cached value differs from value, and update the cache. Returns true if it should be issued.
+static inline bool sf_gl_changes(GLuint *cached, const GLuint value) {
+    if (*cached == value) {
+        sf_gl_current->counters.skipped++;
+        return false;
+    }
+    *cached = value;
+    sf_gl_current->counters.issued++;
+    return true;
+}
+
+/// Use a program, like glUseProgram.
+static inline void sf_gl_use_program(const GLuint program) {
+    if (sf_gl_changes(&sf_gl_current->program, program))
+        glUseProgram(program);
+}
+/// Bind a vertex array, like glBindVertexArray.
+/// The element buffer binding belongs to the vao, so it becomes unknown.
+static inline void sf_gl_bind_vao(const GLuint vao) {
+    if (sf_gl_changes(&sf_gl_current->vao, vao)) {
+        glBindVertexArray(vao);
+        sf_gl_current->element_buffer = SF_GL_UNKNOWN;
+    }
+}
+/// Bind a buffer, like glBindBuffer. Targets other than array, element array and copy buffers aren't cached.
+static inline void sf_gl_bind_buffer(const GLenum target, const GLuint buffer) {
+    GLuint *cached;
+    switch (target) {
+        case GL_ARRAY_BUFFER: cached = &sf_gl_current->array_buffer; break;
+        case GL_ELEMENT_ARRAY_BUFFER: cached = &sf_gl_current->element_buffer; break;
+        case GL_COPY_READ_BUFFER: cached = &sf_gl_current->copy_read_buffer; break;
+        case GL_COPY_WRITE_BUFFER: cached = &sf_gl_current->copy_write_buffer; break;
+        default:
+            sf_gl_current->counters.issued++;
+            glBindBuffer(target, buffer);
+            return;
+    }
+    if (sf_gl_changes(cached, buffer))
+        glBindBuffer(target, buffer);
+}
+/// Bind a framebuffer for drawing and reading, like glBindFramebuffer(GL_FRAMEBUFFER, ...).
+static inline void sf_gl_bind_framebuffer(const GLuint framebuffer) {
+    if (sf_gl_changes(&sf_gl_current->framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+/// Bind a 2d texture to a texture unit, switching the active unit only if the binding changes.
+static inline void sf_gl_bind_texture(const GLuint unit, const GLuint texture) {
+    if (unit < SF_GL_TEXTURE_UNITS && sf_gl_current->textures[unit] == texture) {
+        sf_gl_current->counters.skipped++;
+        return;
+    }
+    if (sf_gl_changes(&sf_gl_current->active_texture, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    if (unit < SF_GL_TEXTURE_UNITS)
+        sf_gl_current->textures[unit] = texture;
+    sf_gl_current->counters.issued++;
+    glBindTexture(GL_TEXTURE_2D, texture);
+}
+/// Bind a range of a uniform buffer to a binding point, like glBindBufferRange(GL_UNIFORM_BUFFER, ...).
+static inline void sf_gl_bind_uniform_range(const GLuint index, const GLuint buffer, const GLintptr offset, const GLsizeiptr size) {
+    if (index < SF_GL_UNIFORM_BINDINGS) {
+        sf_gl_range *cached = sf_gl_current->uniform_ranges + index;
+        if (cached->buffer == buffer && cached->offset == offset && cached->size == size) {
+            sf_gl_current->counters.skipped++;
+            return;
+        }
+        *cached = (sf_gl_range){buffer, offset, size};
+    }
+    sf_gl_current->counters.issued++;
+    glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+}
+/// Set the viewport, like glViewport.
+static inline void sf_gl_viewport(const GLint x, const GLint y, const GLint width, const GLint height) {
+    GLint *v = sf_gl_current->viewport;
+    if (v[0] == x && v[1] == y && v[2] == width && v[3] == height) {
+        sf_gl_current->counters.skipped++;
+        return;
+    }
+    v[0] = x, v[1] = y, v[2] = width, v[3] = height;
+    sf_gl_current->counters.issued++;
+    glViewport(x, y, width, height);
+}
+/// Enable or disable a capability, like glEnable and glDisable. Only depth testing and blending are cached.
+static inline void sf_gl_set(const GLenum cap, const bool enabled) {
+    int8_t *cached = cap == GL_DEPTH_TEST ? &sf_gl_current->depth_test : cap == GL_BLEND ? &sf_gl_current->blend : NULL;
+    if (cached && *cached == (int8_t)enabled) {
+        sf_gl_current->counters.skipped++;
+        return;
+    }
+    if (cached)
+        *cached = (int8_t)enabled;
+    sf_gl_current->counters.issued++;
+    enabled ? glEnable(cap) : glDisable(cap);
+}
+
+/// Delete buffers, like glDeleteBuffers, and forget the bindings of any that were bound.
+EXPORT void sf_gl_delete_buffers(GLsizei n, const GLuint *buffers);
+/// Delete vertex arrays, like glDeleteVertexArrays, and forget the binding if one was bound.
+EXPORT void sf_gl_delete_vaos(GLsizei n, const GLuint *vaos);
+/// Delete textures, like glDeleteTextures, and forget the units they were bound to.
+EXPORT void sf_gl_delete_textures(GLsizei n, const GLuint *textures);
+/// Delete framebuffers, like glDeleteFramebuffers, and forget the binding if one was bound.
+EXPORT void sf_gl_delete_framebuffers(GLsizei n, const GLuint *framebuffers);
+/// Delete a program, like glDeleteProgram, and forget it if it was in use.
+EXPORT void sf_gl_delete_program(GLuint program);
+
+#endif // STATE_H
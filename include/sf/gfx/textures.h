@@ -19,6 +19,8 @@ typedef struct {
     sf_texture_type type;
     GLuint handle;
     sf_vec2 dimensions;
+    /// The file it was loaded from, or empty if it wasn't.
+    sf_str path;
 } sf_texture;
 #define EXPECTED_NAME sf_texture_ex
 #define EXPECTED_O sf_texture
@@ -29,6 +31,8 @@ EXPORT sf_texture sf_texture_new(sf_texture_type type, sf_vec2 dimensions);
 /// Load a texture from a file and upload it to the gpu.
 EXPORT sf_texture_ex sf_texture_load(sf_str path);
 static inline sf_texture_ex sf_texture_cload(const char *path) { return sf_texture_load(sf_ref(path)); }
+/// Replace a texture's contents with RGBA8 pixels of any size, keeping its handle, and generate its mipmaps.
+EXPORT void sf_texture_set_pixels(sf_texture *texture, const uint8_t *pixels, sf_vec2 dimensions);
 /// Resize a texture without first deleting it.
 EXPORT void sf_texture_resize(sf_texture *texture, sf_vec2 dimensions);
 /// Free a texture's resources.
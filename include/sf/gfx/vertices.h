@@ -0,0 +1,296 @@
+#ifndef VERTICES_H
+#define VERTICES_H
+
+#include <sf/math.h>
+#include <string.h>
+#include "export.h"
+#include "sf/gfx/shaders.h"
+
+/// Contains vertex data for composing a mesh.
+#pragma pack(push, 1)
+typedef struct {
+    sf_vec3 position;
+    sf_vec2 uv;
+    sf_glcolor color;
+} sf_vertex;
+#pragma pack(pop)
+
+#define VEC_NAME sf_vertex_vec
+#define VEC_T sf_vertex
+#include <sf/containers/vec.h>
+
+/// Predefined vertex layouts. sf_vertex is converted on the way in, so compact formats lose some precision.
+typedef enum {
+    /// A hand-written layout. sf_vertex is converted attribute by attribute.
+    SF_VERTEX_CUSTOM,
+    /// 36 bytes: float position, float uv, float color. The same as sf_vertex.
+    SF_VERTEX_FLOAT,
+    /// 20 bytes: float position, unorm16 uv (clamped to 0..1), rgba8 color.
+    SF_VERTEX_COMPACT,
+    /// 16 bytes: half position, half uv, rgba8 color.
+    SF_VERTEX_HALF,
+    /// 12 bytes: float position only, for depth and shadow passes.
+    SF_VERTEX_POSITION,
+} sf_vertex_format;
+
+/// Attribute locations that sf_vertex's fields are written to.
+/// Other locations can only be filled through raw vertex data.
+#define SF_ATTRIB_POSITION 0
+#define SF_ATTRIB_UV       1
+#define SF_ATTRIB_COLOR    2
+#define SF_ATTRIB_NORMAL   3
+#define SF_ATTRIB_TANGENT  4
+/// First of the four locations (one per column) that per-instance model matrices are streamed to.
+/// Layouts drawn with sf_mesh_draw_instanced can't use locations 12 to 15.
+#define SF_ATTRIB_INSTANCE 12
+/// Bits of the locations SF_ATTRIB_INSTANCE's four columns take.
+#define SF_ATTRIB_INSTANCE_LOCATIONS (0xFu << SF_ATTRIB_INSTANCE)
+
+#define SF_VERTEX_MAX_ATTRIBS 8
+
+/// One attribute of a vertex, as passed to glVertexAttribPointer.
+typedef struct {
+    GLuint location;
+    GLint components;
+    GLenum type;
+    GLboolean normalized;
+    uint32_t offset;
+} sf_vertex_attrib;
+
+/// Describes how the vertices of a mesh are laid out in memory.
+typedef struct {
+    /// Which predefined layout this is. Hand-written layouts are SF_VERTEX_CUSTOM.
+    sf_vertex_format format;
+    sf_vertex_attrib attribs[SF_VERTEX_MAX_ATTRIBS];
+    uint8_t count;
+    uint32_t stride;
+} sf_vertex_layout;
+
+/// Get the size in bytes of a single component of an attribute type.
+static inline uint32_t sf_gl_type_size(const GLenum type) {
+    switch (type) {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+        case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+        default: return 4;
+    }
+}
+
+/// Append an attribute to the end of a layout, and grow its stride to fit.
+/// Returns false, leaving the layout as it was, if it already has SF_VERTEX_MAX_ATTRIBS attributes,
+/// or the attribute isn't 1 to 4 components of a type sf_vertex_encode can write.
+EXPORT bool sf_vertex_layout_push(sf_vertex_layout *layout, GLuint location, GLint components, GLenum type, GLboolean normalized);
+/// Get the layout of a predefined format.
+EXPORT sf_vertex_layout sf_vertex_format_layout(sf_vertex_format format);
+/// Find the attribute at a location in a layout, or NULL.
+EXPORT const sf_vertex_attrib *sf_vertex_layout_find(const sf_vertex_layout *layout, GLuint location);
+/// Get a bit for each location below 32 that a layout has an attribute at.
+static inline uint32_t sf_vertex_layout_locations(const sf_vertex_layout *layout) {
+    uint32_t locations = 0;
+    for (uint8_t i = 0; i < layout->count; ++i) {
+        if (layout->attribs[i].location < 32)
+            locations |= 1u << layout->attribs[i].location;
+    }
+    return locations;
+}
+
+#pragma pack(push, 1)
+/// A vertex in the SF_VERTEX_COMPACT format.
+typedef struct {
+    sf_vec3 position;
+    uint16_t uv[2];
+    uint8_t color[4];
+} sf_vertex_compact;
+/// A vertex in the SF_VERTEX_HALF format. The position's w is always 1.
+typedef struct {
+    uint16_t position[4];
+    uint16_t uv[2];
+    uint8_t color[4];
+} sf_vertex_half;
+#pragma pack(pop)
+
+/// Convert a float to an IEEE half float, rounding to nearest even.
+static inline uint16_t sf_float_half(const float value) {
+    uint32_t x;
+    memcpy(&x, &value, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mant = x & 0x007FFFFF;
+    const int32_t exp = (int32_t)((x >> 23) & 0xFF) - 127 + 15;
+
+    if (((x >> 23) & 0xFF) == 0xFF)
+        return (uint16_t)(sign | 0x7C00 | (mant ? 0x200 : 0));
+    if (exp >= 31)
+        return (uint16_t)(sign | 0x7C00);
+    if (exp <= 0) {
+        if (exp < -10)
+            return (uint16_t)sign;
+        mant |= 0x00800000;
+        const uint32_t shift = (uint32_t)(14 - exp);
+        uint32_t half = mant >> shift;
+        const uint32_t rem = mant & ((1u << shift) - 1), mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1)))
+            half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exp << 10) | (mant >> 13);
+    const uint32_t rem = mant & 0x1FFF;
+    if (rem > 0x1000 || (rem == 0x1000 && (half & 1)))
+        half++;
+    return (uint16_t)half;
+}
+/// Convert an IEEE half float to a float.
+static inline float sf_half_float(const uint16_t half) {
+    const uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exp = (half >> 10) & 0x1F, mant = half & 0x3FF, x;
+    if (exp == 0 && mant == 0) {
+        x = sign;
+    } else if (exp == 0) {
+        exp = 127 - 15 + 1;
+        while (!(mant & 0x400)) {
+            mant <<= 1;
+            exp--;
+        }
+        x = sign | (exp << 23) | ((mant & 0x3FF) << 13);
+    } else if (exp == 31) {
+        x = sign | 0x7F800000 | (mant << 13);
+    } else x = sign | ((exp + 112) << 23) | (mant << 13);
+
+    float value;
+    memcpy(&value, &x, sizeof(value));
+    return value;
+}
+
+/// Convert vertices into a layout. out must have room for count vertices of that layout.
+/// Attributes at locations sf_vertex doesn't have are zeroed.
+EXPORT void sf_vertex_encode(const sf_vertex_layout *layout, const sf_vertex *vertices, void *out, size_t count);
+
+/// Read one attribute of an encoded vertex back as floats. Missing components are 0, and w is 1.
+EXPORT void sf_vertex_attrib_decode(const sf_vertex_attrib *attrib, const void *vertex, float out[4]);
+/// Decode the positions of count vertices in a layout. Layouts without a position decode to zero.
+EXPORT void sf_vertex_positions(const sf_vertex_layout *layout, const void *vertices, size_t count, sf_vec3 *out);
+
+/// A growable array of vertices that are already in a mesh's format.
+typedef struct {
+    uint8_t *data;
+    size_t count, capacity;
+    size_t stride;
+} sf_vertex_data;
+
+/// Create an empty array of vertices with the given size.
+EXPORT sf_vertex_data sf_vertex_data_new(size_t stride);
+/// Free an array of vertices.
+EXPORT void sf_vertex_data_free(sf_vertex_data *data);
+/// Make room for at least count vertices.
+EXPORT void sf_vertex_data_reserve(sf_vertex_data *data, size_t count);
+/// Copy a vertex to the end of an array.
+static inline void sf_vertex_data_push(sf_vertex_data *data, const void *vertex) {
+    if (data->count == data->capacity)
+        sf_vertex_data_reserve(data, data->count + 1);
+    memcpy(data->data + data->count++ * data->stride, vertex, data->stride);
+}
+/// Get a pointer to the vertex at an index.
+static inline void *sf_vertex_data_at(const sf_vertex_data *data, const size_t index) {
+    return data->data + index * data->stride;
+}
+
+/// A growable array of mesh indices.
+/// Indices are stored as GL_UNSIGNED_SHORT until one doesn't fit, then the whole array is widened to GL_UNSIGNED_INT.
+typedef struct {
+    void *data;
+    size_t count, capacity;
+    GLenum type;
+} sf_index_data;
+
+/// Get the size of a single index of a type.
+static inline size_t sf_index_size(const GLenum type) { return type == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+/// Create an empty array of 16-bit indices.
+EXPORT sf_index_data sf_index_data_new(void);
+/// Free an array of indices.
+EXPORT void sf_index_data_free(sf_index_data *data);
+/// Make room for at least count indices.
+EXPORT void sf_index_data_reserve(sf_index_data *data, size_t count);
+/// Convert an array of 16-bit indices to 32-bit.
+EXPORT void sf_index_data_widen(sf_index_data *data);
+/// Append an index, widening the array if it doesn't fit in 16 bits.
+/// Returns true if the array was widened.
+static inline bool sf_index_data_push(sf_index_data *data, const uint32_t index) {
+    bool widened = false;
+    if (index > UINT16_MAX && data->type == GL_UNSIGNED_SHORT) {
+        sf_index_data_widen(data);
+        widened = true;
+    }
+    if (data->count == data->capacity)
+        sf_index_data_reserve(data, data->count + 1);
+    if (data->type == GL_UNSIGNED_SHORT)
+        ((uint16_t *)data->data)[data->count++] = (uint16_t)index;
+    else ((uint32_t *)data->data)[data->count++] = index;
+    return widened;
+}
+/// Get the index at a position.
+static inline uint32_t sf_index_data_get(const sf_index_data *data, const size_t i) {
+    return data->type == GL_UNSIGNED_SHORT ? ((const uint16_t *)data->data)[i] : ((const uint32_t *)data->data)[i];
+}
+
+/// Marks an empty slot, or a vertex that couldn't be found.
+#define SF_VERTEX_NONE UINT32_MAX
+
+/// Hash the raw bytes of a vertex.
+EXPORT uint64_t sf_vertex_hash(const void *vertex, size_t size);
+/// Compare the raw bytes of two vertices.
+EXPORT bool sf_vertex_eq(const void *v1, const void *v2, size_t size);
+
+/// A single (hash, index) pair in a vertex table.
+typedef struct {
+    uint64_t hash;
+    uint32_t index;
+} sf_vertex_slot;
+
+/// An open-addressing table for deduplicating vertices, probed linearly.
+/// Vertices aren't copied into the table; slots hold an index into a vertex array (the pool)
+/// that keys are compared against, so the pool must be passed to every lookup.
+typedef struct {
+    sf_vertex_slot *slots;
+    size_t capacity, count;
+} sf_vertex_table;
+
+/// Create a new, empty vertex table.
+EXPORT sf_vertex_table sf_vertex_table_new(void);
+/// Free a vertex table's slots.
+EXPORT void sf_vertex_table_free(sf_vertex_table *table);
+/// Make room for at least count vertices without rehashing.
+EXPORT void sf_vertex_table_reserve(sf_vertex_table *table, size_t count);
+/// Find the index of a vertex in the pool, or SF_VERTEX_NONE.
+EXPORT uint32_t sf_vertex_table_find(const sf_vertex_table *table, const void *pool, size_t stride, const void *vertex, uint64_t hash);
+/// Find the index of a vertex in the pool, or insert it with the given index if it is new.
+/// Returns the index the vertex ends up with; it is new if that equals index.
+EXPORT uint32_t sf_vertex_table_intern(sf_vertex_table *table, const void *pool, size_t stride, const void *vertex, uint64_t hash, uint32_t index);
+/// Empty a table and insert the first count vertices of a pool, each under its own index.
+EXPORT void sf_vertex_table_rebuild(sf_vertex_table *table, const void *pool, size_t stride, size_t count);
+
+/// A batch of incoming vertices, and the result of deduplicating it.
+/// Every output array must have room for count elements.
+typedef struct {
+    const void *vertices;
+    size_t count, stride;
+
+    /// The final index of each incoming vertex.
+    uint32_t *remap;
+    /// The position of each vertex that wasn't already known, in first-seen order.
+    uint32_t *unique;
+    /// The hash of each incoming vertex.
+    uint64_t *hashes;
+} sf_vertex_batch;
+
+/// Fewest vertices sf_vertex_table_dedup gives each thread. Starting a thread costs about as much as
+/// deduplicating a few thousand vertices, so smaller batches use fewer threads, down to none.
+#define SF_VERTEX_DEDUP_PER_THREAD 16384
+
+/// Deduplicate a batch against a table and its pool, and against itself, using up to threads threads.
+/// Vertices are split into shards by hash, each shard is deduplicated on its own thread and the
+/// results are stitched together afterwards. New vertices are numbered from base in the order
+/// they are first seen, so the result is identical to interning the batch one vertex at a time.
+/// The table isn't modified; returns how many new vertices were found.
+EXPORT size_t sf_vertex_table_dedup(const sf_vertex_table *table, const void *pool, sf_vertex_batch *batch, uint32_t base, uint32_t threads);
+
+#endif // VERTICES_H
@@ -5,6 +5,8 @@
 #include "sf/gfx/camera.h"
 #include "export.h"
 #include "meshes.h"
+#include "queue.h"
+#include "reload.h"
 
 #define SF_KEY_PRESSED 2
 #define SF_KEY_DOWN 1
@@ -119,6 +121,16 @@ typedef struct {
 
     sf_camera *camera;
     sf_mesh fb_mesh;
+    /// Draw counters of the last finished frame.
+    sf_draw_stats stats;
+    /// Draws submitted over the frame, drawn in sf_window_draw.
+    sf_render_queue queue;
+    /// The state cache of the window's context.
+    sf_gl_state gl;
+    /// State changes and uniform uploads issued and skipped in the last finished frame.
+    sf_gl_counters gl_calls;
+    /// Applied at the start of every frame if set. The window doesn't own it.
+    sf_reloader *reloader;
 
     int8_t keyboard[GLFW_KEY_LAST + 1];
     uint8_t kb_p;
@@ -155,8 +167,17 @@ sf_str sf_key_string(sf_window *window);
 EXPORT void sf_window_set_camera(sf_window *window, sf_camera *camera);
 /// Prepare for a frame, and/or return whether a window should close.
 /// Use this in a while loop.
-EXPORT bool sf_window_loop(const sf_window *window);
-/// Swap a window's buffers and finish the frame.
+EXPORT bool sf_window_loop(sf_window *window);
+/// Queue a mesh to be drawn with the rest of the frame, sorted to share as much state as possible.
+/// Everything passed must live until sf_window_draw.
+static inline void sf_window_submit(sf_window *window, sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform transform, const sf_texture *texture) {
+    sf_render_queue_push(&window->queue, mesh, shader, camera, transform, texture);
+}
+/// Queue a mesh to be drawn with a material, like sf_window_submit. The material must live until sf_window_draw.
+static inline void sf_window_submit_material(sf_window *window, sf_mesh *mesh, const sf_material *material, const sf_camera *camera, const sf_transform transform) {
+    sf_render_queue_push_material(&window->queue, mesh, material, camera, transform);
+}
+/// Draw the submitted meshes, swap a window's buffers and finish the frame.
 EXPORT sf_draw_ex sf_window_draw(sf_window *window, sf_shader *post_shader);
 
 /// Set the displayed title of a window.
@@ -0,0 +1,225 @@
+#include <stdlib.h>
+#include "sf/gfx/arena.h"
+#include "sf/gfx/meshes.h"
+
+sf_arena_allocator sf_arena_allocator_new(const size_t size) {
+    sf_arena_allocator allocator = {.size = size};
+    sf_arena_release(&allocator, (sf_arena_range){0, size});
+    return allocator;
+}
+
+void sf_arena_allocator_free(sf_arena_allocator *allocator) {
+    free(allocator->free);
+    *allocator = (sf_arena_allocator){0};
+}
+
+/// Insert a free range at a position of the list.
+static void sf_arena_insert(sf_arena_allocator *allocator, const size_t at, const sf_arena_range range) {
+    if (allocator->count == allocator->capacity) {
+        allocator->capacity = allocator->capacity ? allocator->capacity * 2 : 16;
+        allocator->free = realloc(allocator->free, allocator->capacity * sizeof(sf_arena_range));
+    }
+    memmove(allocator->free + at + 1, allocator->free + at, (allocator->count - at) * sizeof(sf_arena_range));
+    allocator->free[at] = range;
+    allocator->count++;
+}
+
+/// Remove the free range at a position of the list.
+static void sf_arena_remove(sf_arena_allocator *allocator, const size_t at) {
+    memmove(allocator->free + at, allocator->free + at + 1, (allocator->count - at - 1) * sizeof(sf_arena_range));
+    allocator->count--;
+}
+
+size_t sf_arena_alloc(sf_arena_allocator *allocator, const size_t size) {
+    for (size_t i = 0; i < allocator->count; ++i) {
+        sf_arena_range *range = allocator->free + i;
+        if (range->size < size)
+            continue;
+        const size_t offset = range->offset;
+        range->offset += size;
+        range->size -= size;
+        if (range->size == 0)
+            sf_arena_remove(allocator, i);
+        return offset;
+    }
+    return SF_ARENA_NONE;
+}
+
+void sf_arena_release(sf_arena_allocator *allocator, const sf_arena_range range) {
+    if (range.size == 0)
+        return;
+
+    // Binary search for the first free range after this one.
+    size_t lo = 0, hi = allocator->count;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (allocator->free[mid].offset < range.offset)
+            lo = mid + 1;
+        else hi = mid;
+    }
+
+    const bool joins_prev = lo > 0 && allocator->free[lo - 1].offset + allocator->free[lo - 1].size == range.offset;
+    const bool joins_next = lo < allocator->count && range.offset + range.size == allocator->free[lo].offset;
+    if (joins_prev && joins_next) {
+        allocator->free[lo - 1].size += range.size + allocator->free[lo].size;
+        sf_arena_remove(allocator, lo);
+    } else if (joins_prev) {
+        allocator->free[lo - 1].size += range.size;
+    } else if (joins_next) {
+        allocator->free[lo].offset = range.offset;
+        allocator->free[lo].size += range.size;
+    } else sf_arena_insert(allocator, lo, range);
+}
+
+void sf_arena_grow(sf_arena_allocator *allocator, const size_t size) {
+    if (size <= allocator->size)
+        return;
+    const size_t old = allocator->size;
+    allocator->size = size;
+    sf_arena_release(allocator, (sf_arena_range){old, size - old});
+}
+
+size_t sf_arena_free_size(const sf_arena_allocator *allocator) {
+    size_t total = 0;
+    for (size_t i = 0; i < allocator->count; ++i)
+        total += allocator->free[i].size;
+    return total;
+}
+
+float sf_arena_fragmentation(const sf_arena_allocator *allocator) {
+    size_t total = 0, largest = 0;
+    for (size_t i = 0; i < allocator->count; ++i) {
+        total += allocator->free[i].size;
+        if (allocator->free[i].size > largest)
+            largest = allocator->free[i].size;
+    }
+    return total ? 1.0f - (float)largest / (float)total : 0.0f;
+}
+
+/// Point an arena's vao at its current buffers, with every attribute enabled.
+static void sf_geometry_arena_bind(sf_geometry_arena *arena) {
+    sf_gl_bind_vao(arena->vao);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, arena->vbo);
+    sf_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, arena->ebo);
+    for (uint8_t i = 0; i < arena->layout.count; ++i) {
+        const sf_vertex_attrib *attrib = arena->layout.attribs + i;
+        glEnableVertexAttribArray(attrib->location);
+        glVertexAttribPointer(attrib->location, attrib->components, attrib->type, attrib->normalized,
+            (GLsizei)arena->layout.stride, (void*)(uintptr_t)attrib->offset);
+    }
+    arena->enabled_attribs = sf_vertex_layout_locations(&arena->layout);
+    sf_gl_bind_vao(0);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+}
+
+/// Create a buffer of a size in bytes, without any data.
+static GLuint sf_geometry_arena_buffer(const size_t bytes) {
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    sf_gl_bind_buffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)bytes, NULL, GL_DYNAMIC_DRAW);
+    return buffer;
+}
+
+sf_geometry_arena sf_geometry_arena_new(const sf_vertex_layout *layout, const size_t vertex_capacity, const size_t index_capacity) {
+    sf_geometry_arena arena = {
+        .layout = *layout,
+        .vertices = sf_arena_allocator_new(vertex_capacity),
+        .indices = sf_arena_allocator_new(index_capacity * sizeof(uint32_t)),
+    };
+    glGenVertexArrays(1, &arena.vao);
+    arena.vbo = sf_geometry_arena_buffer(vertex_capacity * layout->stride);
+    arena.ebo = sf_geometry_arena_buffer(index_capacity * sizeof(uint32_t));
+    sf_geometry_arena_bind(&arena);
+    sf_opengl_log();
+    return arena;
+}
+
+void sf_geometry_arena_delete(sf_geometry_arena *arena) {
+    sf_gl_delete_vaos(1, &arena->vao);
+    sf_gl_delete_buffers(1, &arena->vbo);
+    sf_gl_delete_buffers(1, &arena->ebo);
+    sf_arena_allocator_free(&arena->vertices);
+    sf_arena_allocator_free(&arena->indices);
+}
+
+/// Move the first used bytes of a buffer into a new one of a larger size, and delete the old one.
+static GLuint sf_geometry_arena_regrow(const GLuint buffer, const size_t used, const size_t bytes) {
+    const GLuint grown = sf_geometry_arena_buffer(bytes);
+    sf_gl_bind_buffer(GL_COPY_READ_BUFFER, buffer);
+    if (used)
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)used);
+    sf_gl_delete_buffers(1, &buffer);
+    return grown;
+}
+
+/// Allocate from one of an arena's buffers, doubling it until the allocation fits.
+static size_t sf_geometry_arena_alloc(sf_geometry_arena *arena, sf_arena_allocator *allocator, GLuint *buffer, const size_t size, const size_t unit) {
+    const size_t offset = sf_arena_alloc(allocator, size);
+    if (offset != SF_ARENA_NONE)
+        return offset;
+
+    size_t grown = allocator->size ? allocator->size * 2 : size;
+    while (grown - allocator->size < size)
+        grown *= 2;
+    *buffer = sf_geometry_arena_regrow(*buffer, allocator->size * unit, grown * unit);
+    sf_arena_grow(allocator, grown);
+    sf_geometry_arena_bind(arena);
+    return sf_arena_alloc(allocator, size);
+}
+
+sf_arena_range sf_geometry_arena_alloc_vertices(sf_geometry_arena *arena, const size_t count) {
+    if (count == 0)
+        return (sf_arena_range){0, 0};
+    return (sf_arena_range){sf_geometry_arena_alloc(arena, &arena->vertices, &arena->vbo, count, arena->layout.stride), count};
+}
+
+sf_arena_range sf_geometry_arena_alloc_indices(sf_geometry_arena *arena, size_t bytes) {
+    if (bytes == 0)
+        return (sf_arena_range){0, 0};
+    bytes = (bytes + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    return (sf_arena_range){sf_geometry_arena_alloc(arena, &arena->indices, &arena->ebo, bytes, 1), bytes};
+}
+
+void sf_geometry_arena_compact(sf_geometry_arena *arena, sf_mesh *const *meshes, const size_t count) {
+    const size_t stride = arena->layout.stride;
+    const GLuint vbo = sf_geometry_arena_buffer(arena->vertices.size * stride);
+    sf_gl_bind_buffer(GL_COPY_READ_BUFFER, arena->vbo);
+    size_t vertex_end = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sf_arena_range *range = &meshes[i]->vertex_range;
+        if (range->size)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                (GLintptr)(range->offset * stride), (GLintptr)(vertex_end * stride), (GLsizeiptr)(range->size * stride));
+        range->offset = vertex_end;
+        vertex_end += range->size;
+    }
+
+    const GLuint ebo = sf_geometry_arena_buffer(arena->indices.size);
+    sf_gl_bind_buffer(GL_COPY_READ_BUFFER, arena->ebo);
+    size_t index_end = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sf_arena_range *range = &meshes[i]->index_range;
+        if (range->size)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                (GLintptr)range->offset, (GLintptr)index_end, (GLsizeiptr)range->size);
+        range->offset = index_end;
+        index_end += range->size;
+    }
+
+    sf_gl_delete_buffers(1, &arena->vbo);
+    sf_gl_delete_buffers(1, &arena->ebo);
+    arena->vbo = vbo;
+    arena->ebo = ebo;
+    sf_geometry_arena_bind(arena);
+
+    // Everything in use is now packed at the start of each buffer.
+    const size_t vertex_size = arena->vertices.size, index_size = arena->indices.size;
+    sf_arena_allocator_free(&arena->vertices);
+    sf_arena_allocator_free(&arena->indices);
+    arena->vertices = (sf_arena_allocator){.size = vertex_size};
+    arena->indices = (sf_arena_allocator){.size = index_size};
+    sf_arena_release(&arena->vertices, (sf_arena_range){vertex_end, vertex_size - vertex_end});
+    sf_arena_release(&arena->indices, (sf_arena_range){index_end, index_size - index_end});
+    sf_opengl_log();
+}
@@ -1,3 +1,5 @@
+#include <stdlib.h>
+#include <string.h>
 #include "sf/gfx/camera.h"
 #include "sf/gfx/shaders.h"
 
@@ -14,7 +16,7 @@ sf_camera sf_camera_new(const sf_camera_type type, const float fov, const float
 
 void sf_camera_delete(sf_camera *camera) {
     if (camera->framebuffer != 0) {
-        glDeleteFramebuffers(1, &camera->framebuffer);
+        sf_gl_delete_framebuffers(1, &camera->framebuffer);
         sf_texture_delete(&camera->fb_color);
         sf_texture_delete(&camera->fb_stencil);
     }
@@ -30,6 +32,140 @@ sf_vec3 sf_camera_right(const sf_camera *camera) {
     return (sf_vec3){vec[0], vec[1], vec[2]};
 }
 
+void sf_camera_view(mat4 out, const sf_camera *camera) {
+    sf_transform cp = camera->transform;
+    cp.position = (sf_vec3){-cp.position.x, -cp.position.y, -cp.position.z};
+    sf_transform_model(out, cp);
+}
+
+void sf_camera_block_fill(sf_camera_block *out, const sf_camera *camera) {
+    mat4 view, projection;
+    sf_camera_view(view, camera);
+    if (camera->type == SF_CAMERA_RENDER_DEFAULT)
+        glm_mat4_identity(projection);
+    else glm_mat4_copy((vec4 *)camera->projection, projection);
+    memcpy(out->projection, projection, sizeof(out->projection));
+    memcpy(out->view, view, sizeof(out->view));
+
+    const sf_vec3 position = camera->transform.position;
+    const sf_vec2 viewport = camera->viewport;
+    out->position[0] = position.x, out->position[1] = position.y, out->position[2] = position.z, out->position[3] = 1.0f;
+    out->viewport[0] = viewport.x, out->viewport[1] = viewport.y;
+    out->viewport[2] = viewport.x > 0 ? 1.0f / viewport.x : 0.0f;
+    out->viewport[3] = viewport.y > 0 ? 1.0f / viewport.y : 0.0f;
+}
+
+/// Everything a camera's block is computed from, to tell when it has to be computed again.
+typedef struct {
+    sf_camera_type type;
+    sf_vec3 position, rotation, scale;
+    float projection[16];
+    sf_vec2 viewport;
+} sf_camera_inputs;
+
+/// A camera's place in the uniform buffer, and what its block was last computed from.
+typedef struct {
+    const sf_camera *camera;
+    sf_camera_inputs inputs;
+    uint64_t used;
+} sf_camera_slot;
+
+/// A context's uniform buffer of camera blocks. Buffers aren't shared between contexts, so each has its own.
+struct sf_camera_blocks {
+    GLuint ubo;
+    GLintptr stride;
+    sf_camera_slot slots[SF_CAMERA_SLOTS];
+    uint64_t clock;
+};
+
+/// Take the inputs of a camera's block. Padding is zeroed so they can be compared with memcmp.
+static void sf_camera_inputs_get(sf_camera_inputs *out, const sf_camera *camera) {
+    memset(out, 0, sizeof(*out));
+    out->type = camera->type;
+    out->position = camera->transform.position;
+    out->rotation = camera->transform.rotation;
+    out->scale = camera->transform.scale;
+    if (camera->type != SF_CAMERA_RENDER_DEFAULT)
+        memcpy(out->projection, camera->projection, sizeof(out->projection));
+    out->viewport = camera->viewport;
+}
+
+void sf_camera_bind_block(const sf_camera *camera) {
+    struct sf_camera_blocks *blocks = sf_gl_current->camera_blocks;
+    if (blocks == NULL) {
+        blocks = sf_gl_current->camera_blocks = calloc(1, sizeof(struct sf_camera_blocks));
+        // Every slot starts on an offset the driver can bind a range at.
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        const GLintptr align = alignment > 0 ? alignment : 256;
+        blocks->stride = ((GLintptr)sizeof(sf_camera_block) + align - 1) / align * align;
+        glGenBuffers(1, &blocks->ubo);
+        sf_gl_bind_buffer(GL_UNIFORM_BUFFER, blocks->ubo);
+        glBufferData(GL_UNIFORM_BUFFER, blocks->stride * SF_CAMERA_SLOTS, NULL, GL_DYNAMIC_DRAW);
+    }
+
+    // The camera's own slot if it has one, otherwise the least recently used.
+    size_t slot = 0;
+    bool found = false;
+    for (size_t i = 0; i < SF_CAMERA_SLOTS; ++i) {
+        if (blocks->slots[i].camera == camera) {
+            slot = i;
+            found = true;
+            break;
+        }
+        if (blocks->slots[i].used < blocks->slots[slot].used)
+            slot = i;
+    }
+
+    // A parent can move without the camera changing, so parented cameras are always uploaded.
+    sf_camera_slot *entry = blocks->slots + slot;
+    sf_camera_inputs inputs;
+    sf_camera_inputs_get(&inputs, camera);
+    if (!found || camera->transform.parent || memcmp(&inputs, &entry->inputs, sizeof(inputs)) != 0) {
+        sf_camera_block block;
+        sf_camera_block_fill(&block, camera);
+        sf_gl_bind_buffer(GL_UNIFORM_BUFFER, blocks->ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)slot * blocks->stride, sizeof(block), &block);
+        entry->camera = camera;
+        memcpy(&entry->inputs, &inputs, sizeof(inputs));
+    }
+    entry->used = ++blocks->clock;
+    sf_gl_bind_uniform_range(SF_CAMERA_BINDING, blocks->ubo, (GLintptr)slot * blocks->stride, sizeof(sf_camera_block));
+}
+
+void sf_camera_blocks_free(void) {
+    struct sf_camera_blocks *blocks = sf_gl_current->camera_blocks;
+    if (blocks == NULL)
+        return;
+    sf_gl_delete_buffers(1, &blocks->ubo);
+    free(blocks);
+    sf_gl_current->camera_blocks = NULL;
+}
+
+sf_frustum sf_camera_frustum(const sf_camera *camera) {
+    mat4 view, clip;
+    sf_camera_view(view, camera);
+    if (camera->type == SF_CAMERA_RENDER_DEFAULT)
+        glm_mat4_copy(view, clip);
+    else glm_mat4_mul((vec4 *)camera->projection, view, clip);
+
+    // Gribb & Hartmann: each plane is the w row of the clip matrix plus or minus one of the others.
+    sf_frustum frustum;
+    for (int i = 0; i < 6; ++i) {
+        const int row = i / 2;
+        const float sign = i % 2 ? -1.0f : 1.0f;
+        float *p = frustum.planes[i];
+        for (int c = 0; c < 4; ++c)
+            p[c] = clip[c][3] + sign * clip[c][row];
+        const float length = sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (length > 0) {
+            for (int c = 0; c < 4; ++c)
+                p[c] /= length;
+        }
+    }
+    return frustum;
+}
+
 sf_vec3 sf_camera_forward(const sf_camera *camera) {
     mat4 mat;
     sf_transform_view(mat, camera->transform);
@@ -0,0 +1,132 @@
+#include <stdlib.h>
+#include "sf/gfx/material.h"
+
+sf_material sf_material_new(sf_shader *shader) {
+    static uint32_t sort_ids = 0;
+    sf_material material = {.shader = shader, .sort_id = ++sort_ids};
+    for (uint8_t i = 0; i < SF_MATERIAL_TEXTURES; ++i)
+        material.samplers[i] = SF_UNIFORM_NONE;
+    return material;
+}
+
+void sf_material_free(sf_material *material) {
+    if (material->shader && material->shader->material == material)
+        material->shader->material = NULL;
+    free(material->values);
+    *material = (sf_material){0};
+}
+
+/// Resolve a uniform for a material, and mark it as one a material sets.
+static sf_uniform_id sf_material_uniform(const sf_material *material, const sf_str name) {
+    const sf_uniform_id id = sf_shader_uniform_id(material->shader, name);
+    if (id != SF_UNIFORM_NONE)
+        material->shader->uniform_info[id].material = true;
+    return id;
+}
+
+sf_uniform_ex sf_material_set_texture(sf_material *material, const uint8_t slot, const sf_str sampler, const sf_texture *texture) {
+    if (slot >= SF_MATERIAL_TEXTURES)
+        return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_SLOT, SF_STR_EMPTY});
+    const sf_uniform_id id = sf_material_uniform(material, sampler);
+    if (id == SF_UNIFORM_NONE)
+        return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
+
+    material->textures[slot] = texture;
+    material->samplers[slot] = texture ? id : SF_UNIFORM_NONE;
+    material->version++;
+    return sf_uniform_ex_ok();
+}
+
+/// Set one of a material's values by name, replacing the value it already had for the uniform.
+static sf_uniform_ex sf_material_set(sf_material *material, const sf_str name, const GLenum type, const void *value, const size_t size) {
+    const sf_uniform_id id = sf_material_uniform(material, name);
+    if (id == SF_UNIFORM_NONE)
+        return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
+
+    sf_material_value *slot = NULL;
+    for (uint32_t i = 0; i < material->value_count && slot == NULL; ++i) {
+        if (material->values[i].id == id)
+            slot = material->values + i;
+    }
+    if (slot == NULL) {
+        if (material->value_count == material->value_capacity) {
+            material->value_capacity = material->value_capacity ? material->value_capacity * 2 : 4;
+            material->values = realloc(material->values, material->value_capacity * sizeof(sf_material_value));
+        }
+        slot = material->values + material->value_count++;
+    }
+    *slot = (sf_material_value){id, type, {0}};
+    memcpy(slot->value, value, size);
+    material->version++;
+    return sf_uniform_ex_ok();
+}
+
+sf_uniform_ex sf_material_set_float(sf_material *material, const sf_str name, const float value) {
+    return sf_material_set(material, name, GL_FLOAT, &value, sizeof(value));
+}
+
+sf_uniform_ex sf_material_set_int(sf_material *material, const sf_str name, const int value) {
+    return sf_material_set(material, name, GL_INT, &value, sizeof(value));
+}
+
+sf_uniform_ex sf_material_set_vec2(sf_material *material, const sf_str name, const sf_vec2 value) {
+    return sf_material_set(material, name, GL_FLOAT_VEC2, &value, sizeof(value));
+}
+
+sf_uniform_ex sf_material_set_vec3(sf_material *material, const sf_str name, const sf_vec3 value) {
+    return sf_material_set(material, name, GL_FLOAT_VEC3, &value, sizeof(value));
+}
+
+sf_uniform_ex sf_material_set_mat4(sf_material *material, const sf_str name, const mat4 value) {
+    return sf_material_set(material, name, GL_FLOAT_MAT4, value, sizeof(mat4));
+}
+
+/// Check if a shader still has a material applied as it is now, with its program and textures still bound.
+static bool sf_material_applied(const sf_material *material) {
+    const sf_shader *shader = material->shader;
+    if (shader->material != material || shader->material_version != material->version
+        || sf_gl_current->program != shader->program)
+        return false;
+    for (GLuint slot = 0; slot < SF_MATERIAL_TEXTURES; ++slot) {
+        if (material->textures[slot] && sf_gl_current->textures[slot] != material->textures[slot]->handle)
+            return false;
+    }
+    return true;
+}
+
+void sf_material_apply(const sf_material *material) {
+    if (sf_material_applied(material)) {
+        sf_gl_current->counters.skipped++;
+        return;
+    }
+
+    sf_shader *shader = material->shader;
+    sf_shader_bind(shader);
+    for (GLuint slot = 0; slot < SF_MATERIAL_TEXTURES; ++slot) {
+        if (material->textures[slot] == NULL)
+            continue;
+        sf_gl_bind_texture(slot, material->textures[slot]->handle);
+        sf_shader_set_int(shader, material->samplers[slot], (int)slot);
+    }
+    for (uint32_t i = 0; i < material->value_count; ++i) {
+        const sf_material_value *value = material->values + i;
+        switch (value->type) {
+            case GL_FLOAT: sf_shader_set_float(shader, value->id, value->value[0]); break;
+            case GL_INT: {
+                int v;
+                memcpy(&v, value->value, sizeof(v));
+                sf_shader_set_int(shader, value->id, v);
+            } break;
+            case GL_FLOAT_VEC2: sf_shader_set_vec2(shader, value->id, (sf_vec2){value->value[0], value->value[1]}); break;
+            case GL_FLOAT_VEC3: sf_shader_set_vec3(shader, value->id, (sf_vec3){value->value[0], value->value[1], value->value[2]}); break;
+            default: {
+                mat4 m;
+                memcpy(m, value->value, sizeof(m));
+                sf_shader_set_mat4(shader, value->id, m);
+            } break;
+        }
+    }
+    // Writing its own uniforms made the shader forget any material, so it's remembered last.
+    shader->material = material;
+    shader->material_version = material->version;
+}
@@ -1,3 +1,5 @@
+#include <math.h>
+#include <stddef.h>
 #include "sf/gfx/meshes.h"
 #include "sf/gfx/camera.h"
 #include "sf/gfx/shaders.h"
@@ -12,33 +14,43 @@ const sf_camera *SF_RENDER_DEFAULT = &(sf_camera){
 };
 
 sf_mesh sf_mesh_new(void) {
+    return sf_mesh_new_format(SF_VERTEX_FLOAT);
+}
+
+sf_mesh sf_mesh_new_format(const sf_vertex_format format) {
+    const sf_vertex_layout layout = sf_vertex_format_layout(format);
+    return sf_mesh_new_layout(&layout);
+}
+
+sf_mesh sf_mesh_new_layout(const sf_vertex_layout *layout) {
     sf_mesh mesh = {
-        .vertices = sf_vertex_vec_new(),
-        .indices = sf_index_vec_new(),
-        .cache = sf_index_cache_new(),
+        .layout = *layout,
+        .vertices = sf_vertex_data_new(layout->stride),
+        .indices = sf_index_data_new(),
+        .cache = sf_vertex_table_new(),
         .flags = SF_MESH_ACTIVE | SF_MESH_VISIBLE,
+        .bounds = SF_MESH_BOUNDS_EMPTY,
+        .lod_pixels = SF_MESH_LOD_PIXELS,
     };
 
     glGenVertexArrays(1, &mesh.vao);
     glGenBuffers(1, &mesh.vbo);
     glGenBuffers(1, &mesh.ebo);
 
-    glBindVertexArray(mesh.vao);
-    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
-    // Vertex Position
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), NULL);
-    // UV Coords
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(3 * sizeof(float)));
-    // Vertex Color
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(5 * sizeof(float)));
+    sf_gl_bind_vao(mesh.vao);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, mesh.vbo);
+    sf_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    for (uint8_t i = 0; i < layout->count; ++i) {
+        const sf_vertex_attrib *attrib = layout->attribs + i;
+        glEnableVertexAttribArray(attrib->location);
+        glVertexAttribPointer(attrib->location, attrib->components, attrib->type, attrib->normalized,
+            (GLsizei)layout->stride, (void*)(uintptr_t)attrib->offset);
+    }
+    mesh.enabled_attribs = sf_vertex_layout_locations(layout);
 
     if (CLEAN_BIND) {
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        sf_gl_bind_vao(0);
+        sf_gl_bind_buffer(GL_ARRAY_BUFFER, 0);
     }
 
     sf_opengl_log();
@@ -46,93 +58,576 @@ sf_mesh sf_mesh_new(void) {
     return mesh;
 }
 
+sf_mesh sf_mesh_new_arena(sf_geometry_arena *arena) {
+    return (sf_mesh){
+        .layout = arena->layout,
+        .vertices = sf_vertex_data_new(arena->layout.stride),
+        .indices = sf_index_data_new(),
+        .cache = sf_vertex_table_new(),
+        .flags = SF_MESH_ACTIVE | SF_MESH_VISIBLE,
+        .bounds = SF_MESH_BOUNDS_EMPTY,
+        .lod_pixels = SF_MESH_LOD_PIXELS,
+        .arena = arena,
+    };
+}
+
+/// Free a mesh's cpu data and deduplication table, or unmap the file it was loaded from.
+void sf_mesh_release(sf_mesh *mesh) {
+    // A mapped mesh borrows its arrays; with nothing left to copy, owning them just unmaps the file.
+    if (mesh->mapping) {
+        mesh->vertices.count = mesh->indices.count = 0;
+        sf_mesh_own(mesh);
+    }
+    sf_vertex_data_free(&mesh->vertices);
+    sf_index_data_free(&mesh->indices);
+    sf_vertex_table_free(&mesh->cache);
+}
+
 void sf_mesh_delete(sf_mesh *mesh) {
-    sf_vertex_vec_free(&mesh->vertices);
-    sf_index_vec_free(&mesh->indices);
-    sf_index_cache_free(&mesh->cache);
+    sf_mesh_release(mesh);
 
-    glDeleteVertexArrays(1, &mesh->vao);
-    glDeleteBuffers(1, &mesh->vbo);
-    glDeleteBuffers(1, &mesh->ebo);
+    if (mesh->arena) {
+        sf_arena_release(&mesh->arena->vertices, mesh->vertex_range);
+        sf_arena_release(&mesh->arena->indices, mesh->index_range);
+        mesh->vertex_range = mesh->index_range = (sf_arena_range){0, 0};
+    } else {
+        sf_gl_delete_vaos(1, &mesh->vao);
+        sf_gl_delete_buffers(1, &mesh->vbo);
+        sf_gl_delete_buffers(1, &mesh->ebo);
+    }
+    if (mesh->instance_vbo)
+        sf_gl_delete_buffers(1, &mesh->instance_vbo);
 
     mesh->flags &= ~SF_MESH_ACTIVE;
     mesh->flags &= ~SF_MESH_VISIBLE;
 }
 
-void sf_mesh_update(const sf_mesh *mesh) {
-    glBindVertexArray(mesh->vao);
+/// Smallest number of elements a mesh buffer is allocated with in vram.
+#define SF_MESH_MIN_CAPACITY 64
+/// Batches smaller than this would be deduplicated on one thread anyway, so they take the serial path.
+#define SF_MESH_PARALLEL_MIN (2 * SF_VERTEX_DEDUP_PER_THREAD)
+/// How many vertices are converted to a mesh's format at once.
+#define SF_MESH_STAGING 256
 
-    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
-    glBufferData(GL_ARRAY_BUFFER, (int64_t)(mesh->vertices.count * sizeof(sf_vertex)), mesh->vertices.data, GL_DYNAMIC_DRAW);
+/// Upload the dirty part of a cpu array to the buffer bound to target, whose copy starts at base bytes in.
+static void sf_mesh_flush_dirty(const GLenum target, const size_t base, sf_mesh_range *dirty, const void *data, const size_t count, const size_t stride) {
+    if (dirty->end > count)
+        dirty->end = count;
+    if (dirty->start < dirty->end) {
+        glBufferSubData(target,
+            (GLintptr)(base + dirty->start * stride),
+            (GLsizeiptr)((dirty->end - dirty->start) * stride),
+            (const uint8_t *)data + dirty->start * stride);
+    }
+    *dirty = (sf_mesh_range){0, 0};
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (int64_t)(mesh->indices.count * sizeof(uint32_t)), mesh->indices.data, GL_STATIC_DRAW);
+/// Upload the dirty part of a cpu array to the buffer bound to target.
+/// When the buffer is too small it is reallocated with doubled capacity, and refilled completely.
+void sf_mesh_flush(const GLenum target, size_t *capacity, sf_mesh_range *dirty, const void *data, const size_t count, const size_t stride) {
+    if (count > *capacity) {
+        size_t cap = *capacity < SF_MESH_MIN_CAPACITY ? SF_MESH_MIN_CAPACITY : *capacity;
+        while (cap < count)
+            cap *= 2;
+        glBufferData(target, (GLsizeiptr)(cap * stride), NULL, GL_DYNAMIC_DRAW);
+        *capacity = cap;
+        *dirty = (sf_mesh_range){0, count};
+    }
+    sf_mesh_flush_dirty(target, 0, dirty, data, count, stride);
+}
+
+/// Get the capacity a mesh's range of an arena grows to, to fit count elements.
+/// Ranges start out exact, since most meshes in an arena are never edited again.
+static size_t sf_mesh_arena_grow(const size_t capacity, const size_t count) {
+    size_t cap = capacity ? capacity : count;
+    while (cap < count)
+        cap *= 2;
+    return cap;
+}
+
+/// Upload a mesh's pending changes to its ranges of an arena.
+/// A mesh that outgrows a range moves to a bigger one, and is uploaded there completely.
+static void sf_mesh_update_arena(sf_mesh *mesh) {
+    sf_geometry_arena *arena = mesh->arena;
+    const size_t stride = mesh->vertices.stride, index_size = sf_index_size(mesh->indices.type);
+    if (mesh->vertices.count > mesh->vbo_capacity) {
+        sf_arena_release(&arena->vertices, mesh->vertex_range);
+        mesh->vertex_range = sf_geometry_arena_alloc_vertices(arena, sf_mesh_arena_grow(mesh->vbo_capacity, mesh->vertices.count));
+        mesh->vbo_capacity = mesh->vertex_range.size;
+        mesh->dirty_vertices = (sf_mesh_range){0, mesh->vertices.count};
+    }
+    // Widening the indices drops the capacity to 0, but the range keeps its size in bytes so it can still be released.
+    if (mesh->indices.count > mesh->ebo_capacity) {
+        sf_arena_release(&arena->indices, mesh->index_range);
+        mesh->index_range = sf_geometry_arena_alloc_indices(arena, sf_mesh_arena_grow(mesh->ebo_capacity, mesh->indices.count) * index_size);
+        mesh->ebo_capacity = mesh->index_range.size / index_size;
+        mesh->dirty_indices = (sf_mesh_range){0, mesh->indices.count};
+    }
+
+    sf_gl_bind_vao(arena->vao);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, arena->vbo);
+    sf_mesh_flush_dirty(GL_ARRAY_BUFFER, mesh->vertex_range.offset * stride, &mesh->dirty_vertices,
+        mesh->vertices.data, mesh->vertices.count, stride);
+    sf_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, arena->ebo);
+    sf_mesh_flush_dirty(GL_ELEMENT_ARRAY_BUFFER, mesh->index_range.offset, &mesh->dirty_indices,
+        mesh->indices.data, mesh->indices.count, index_size);
 
     if (CLEAN_BIND) {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        sf_gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+        sf_gl_bind_vao(0);
     }
 }
 
-void _sf_mesh_add_vertex(sf_mesh *mesh, const sf_vertex vertex) {
-    sf_index_cache_ex cache = sf_index_cache_get(&mesh->cache, vertex);
-    if (cache.is_ok) {
-        sf_index_vec_push(&mesh->indices, cache.value.ok);
+void sf_mesh_update(sf_mesh *mesh) {
+    if (!sf_mesh_dirty(mesh))
         return;
+    if (mesh->arena) {
+        sf_mesh_update_arena(mesh);
+        return;
+    }
+    sf_gl_bind_vao(mesh->vao);
+
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, mesh->vbo);
+    sf_mesh_flush(GL_ARRAY_BUFFER, &mesh->vbo_capacity, &mesh->dirty_vertices,
+        mesh->vertices.data, mesh->vertices.count, mesh->vertices.stride);
+
+    sf_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ebo);
+    sf_mesh_flush(GL_ELEMENT_ARRAY_BUFFER, &mesh->ebo_capacity, &mesh->dirty_indices,
+        mesh->indices.data, mesh->indices.count, sf_index_size(mesh->indices.type));
+
+    if (CLEAN_BIND) {
+        sf_gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+        sf_gl_bind_vao(0);
     }
+}
 
-    sf_vertex_vec_push(&mesh->vertices, vertex);
-    sf_index_vec_push(&mesh->indices, (uint32_t)mesh->vertices.count - 1);
-    sf_index_cache_set(&mesh->cache, vertex, (uint32_t)mesh->vertices.count - 1);
+void sf_mesh_push_index(sf_mesh *mesh, const uint32_t index) {
+    // Widening changes the size of every index, so the whole buffer has to be reallocated.
+    if (sf_index_data_push(&mesh->indices, index))
+        mesh->ebo_capacity = 0;
 }
 
-void sf_mesh_add_vertex(sf_mesh *mesh, const sf_vertex vertex) {
-    _sf_mesh_add_vertex(mesh, vertex);
-    sf_mesh_update(mesh);
+uint32_t _sf_mesh_add_vertex(sf_mesh *mesh, const void *vertex, const uint64_t hash) {
+    const uint32_t next = (uint32_t)mesh->vertices.count;
+    const uint32_t index = sf_vertex_table_intern(&mesh->cache, mesh->vertices.data, mesh->vertices.stride, vertex, hash, next);
+    if (index == next) {
+        sf_vertex_data_push(&mesh->vertices, vertex);
+        sf_vec3 position;
+        sf_vertex_positions(&mesh->layout, vertex, 1, &position);
+        sf_mesh_bounds_add(&mesh->bounds, position);
+    }
+    sf_mesh_push_index(mesh, index);
+    return index;
 }
 
-void sf_mesh_add_vertices(sf_mesh *mesh, const sf_vertex *vertices, const size_t count) {
+sf_mesh_ex sf_mesh_add_vertex(sf_mesh *mesh, const sf_vertex vertex) {
+    return sf_mesh_add_vertices(mesh, &vertex, 1);
+}
+
+sf_mesh_ex sf_mesh_add_vertices(sf_mesh *mesh, const sf_vertex *vertices, const size_t count) {
+    const size_t stride = mesh->vertices.stride;
+    if (mesh->flags & SF_MESH_FROZEN)
+        return sf_mesh_ex_err(SF_MESH_EDIT_FROZEN);
+    if (stride == 0)
+        return sf_mesh_ex_err(SF_MESH_EDIT_NO_ATTRIBS);
+    if (mesh->layout.format == SF_VERTEX_FLOAT)
+        return sf_mesh_add_raw(mesh, vertices, count);
+
+    // Vertices are converted to the mesh's layout a chunk at a time, and deduplicated in that form.
+    uint8_t staging[SF_MESH_STAGING * sizeof(sf_vertex)];
+    const size_t chunk = sizeof(staging) / stride;
+    for (size_t i = 0; i < count; i += chunk) {
+        const size_t n = count - i < chunk ? count - i : chunk;
+        sf_vertex_encode(&mesh->layout, vertices + i, staging, n);
+        sf_mesh_add_raw(mesh, staging, n);
+    }
+    return sf_mesh_ex_ok();
+}
+
+sf_mesh_ex sf_mesh_add_raw(sf_mesh *mesh, const void *vertices, const size_t count) {
+    if (mesh->flags & SF_MESH_FROZEN)
+        return sf_mesh_ex_err(SF_MESH_EDIT_FROZEN);
+    if (mesh->vertices.stride == 0)
+        return sf_mesh_ex_err(SF_MESH_EDIT_NO_ATTRIBS);
+    sf_mesh_own(mesh);
+    sf_mesh_lod_clear(mesh);
+    const size_t vstart = mesh->vertices.count, istart = mesh->indices.count;
+    const size_t stride = mesh->vertices.stride;
+    const uint8_t *bytes = vertices;
+    sf_vertex_table_reserve(&mesh->cache, mesh->cache.count + count);
+
+    for (size_t i = 0; i < count; ++i)
+        _sf_mesh_add_vertex(mesh, bytes + i * stride, sf_vertex_hash(bytes + i * stride, stride));
+
+    if (mesh->vertices.count > vstart)
+        sf_mesh_range_mark(&mesh->dirty_vertices, vstart, mesh->vertices.count);
+    if (mesh->indices.count > istart)
+        sf_mesh_range_mark(&mesh->dirty_indices, istart, mesh->indices.count);
+    return sf_mesh_ex_ok();
+}
+
+sf_mesh_ex sf_mesh_add_vertices_parallel(sf_mesh *mesh, const sf_vertex *vertices, const size_t count, const uint32_t threads) {
+    if (threads <= 1 || count < SF_MESH_PARALLEL_MIN || mesh->flags & SF_MESH_FROZEN || mesh->vertices.stride == 0)
+        return sf_mesh_add_vertices(mesh, vertices, count);
+
+    sf_mesh_own(mesh);
+    sf_mesh_lod_clear(mesh);
+    const size_t vstart = mesh->vertices.count, istart = mesh->indices.count;
+    const size_t stride = mesh->vertices.stride;
+    uint8_t *encoded = malloc(count * stride);
+    sf_vertex_encode(&mesh->layout, vertices, encoded, count);
+
+    sf_vertex_batch batch = {
+        .vertices = encoded,
+        .count = count,
+        .stride = stride,
+        .remap = malloc(count * sizeof(uint32_t)),
+        .unique = malloc(count * sizeof(uint32_t)),
+        .hashes = malloc(count * sizeof(uint64_t)),
+    };
+    const uint32_t base = (uint32_t)mesh->vertices.count;
+    const size_t added = sf_vertex_table_dedup(&mesh->cache, mesh->vertices.data, &batch, base, threads);
+
+    sf_vertex_table_reserve(&mesh->cache, mesh->cache.count + added);
+    sf_vertex_data_reserve(&mesh->vertices, mesh->vertices.count + added);
+    for (size_t i = 0; i < added; ++i) {
+        const uint8_t *vertex = encoded + (size_t)batch.unique[i] * stride;
+        sf_vertex_data_push(&mesh->vertices, vertex);
+        sf_vertex_table_intern(&mesh->cache, mesh->vertices.data, stride, vertex, batch.hashes[batch.unique[i]], base + (uint32_t)i);
+        sf_vec3 position;
+        sf_vertex_positions(&mesh->layout, vertex, 1, &position);
+        sf_mesh_bounds_add(&mesh->bounds, position);
+    }
+    sf_index_data_reserve(&mesh->indices, mesh->indices.count + count);
     for (size_t i = 0; i < count; ++i)
-        _sf_mesh_add_vertex(mesh, vertices[i]);
+        sf_mesh_push_index(mesh, batch.remap[i]);
+
+    if (mesh->vertices.count > vstart)
+        sf_mesh_range_mark(&mesh->dirty_vertices, vstart, mesh->vertices.count);
+    sf_mesh_range_mark(&mesh->dirty_indices, istart, mesh->indices.count);
+
+    free(batch.hashes);
+    free(batch.unique);
+    free(batch.remap);
+    free(encoded);
+    return sf_mesh_ex_ok();
+}
+
+void sf_mesh_freeze(sf_mesh *mesh) {
+    if (mesh->flags & SF_MESH_FROZEN)
+        return;
     sf_mesh_update(mesh);
+
+    // Drawing only needs the counts and the index type.
+    const size_t vertex_count = mesh->vertices.count, index_count = mesh->indices.count;
+    const GLenum index_type = mesh->indices.type;
+    sf_mesh_release(mesh);
+    mesh->vertices.count = vertex_count;
+    mesh->indices.count = index_count;
+    mesh->indices.type = index_type;
+    mesh->flags |= SF_MESH_FROZEN;
 }
 
-sf_draw_ex sf_mesh_draw(const sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform transform, const sf_texture *texture) {
-    if (shader == NULL)
-        return sf_draw_ex_err((sf_draw_err){SF_DRAW_SHADER_MISSING, .value.uniform_name = SF_STR_EMPTY});
-    sf_shader_bind(shader);
+sf_draw_stats sf_draw_stats_get(void) { return sf_gl_current->draws; }
+void sf_draw_stats_reset(void) { sf_gl_current->draws = (sf_draw_stats){0}; }
+void sf_draw_stats_count(const size_t drawn, const size_t culled) {
+    sf_gl_current->draws.drawn += drawn;
+    sf_gl_current->draws.culled += culled;
+}
+
+/// Get the largest factor a model matrix scales any axis by.
+static float sf_mat4_max_scale(mat4 m) {
+    float scale = 0;
+    for (int c = 0; c < 3; ++c)
+        scale = fmaxf(scale, sqrtf(m[c][0] * m[c][0] + m[c][1] * m[c][1] + m[c][2] * m[c][2]));
+    return scale;
+}
+
+bool sf_mesh_in_view(const sf_mesh *mesh, const sf_frustum *frustum, mat4 model) {
+    if (mesh->bounds.radius < 0)
+        return true;
+    vec3 center = {mesh->bounds.center.x, mesh->bounds.center.y, mesh->bounds.center.z};
+    glm_mat4_mulv3(model, center, 1.0f, center);
+    return sf_frustum_sphere(frustum, (sf_vec3){center[0], center[1], center[2]}, mesh->bounds.radius * sf_mat4_max_scale(model));
+}
+
+uint8_t sf_mesh_lod_model(const sf_mesh *mesh, const sf_camera *camera, mat4 model) {
+    if (mesh->lod_count < 2 || mesh->bounds.radius < 0)
+        return 0;
+
+    vec3 center = {mesh->bounds.center.x, mesh->bounds.center.y, mesh->bounds.center.z};
+    glm_mat4_mulv3(model, center, 1.0f, center);
+    const float scale = sf_mat4_max_scale(model);
+
+    // How many pixels one unit covers at the nearest point of the mesh. Perspective projections
+    // divide by depth, orthographic ones (and the default camera's identity) don't.
+    const float half_height = camera->viewport.y * 0.5f;
+    float pixels = half_height;
+    if (camera->type != SF_CAMERA_RENDER_DEFAULT) {
+        pixels = camera->projection[1][1] * half_height;
+        if (camera->projection[2][3] != 0) {
+            const sf_vec3 eye = camera->transform.position;
+            const float dx = center[0] - eye.x, dy = center[1] - eye.y, dz = center[2] - eye.z;
+            const float distance = sqrtf(dx * dx + dy * dy + dz * dz) - mesh->bounds.radius * scale;
+            if (distance <= camera->near)
+                return 0;
+            pixels /= distance;
+        }
+    }
+
+    for (uint8_t i = (uint8_t)(mesh->lod_count - 1); i > 0; --i) {
+        if (mesh->lods[i].error * scale * pixels <= mesh->lod_pixels)
+            return i;
+    }
+    return 0;
+}
+
+uint8_t sf_mesh_lod_select(const sf_mesh *mesh, const sf_camera *camera, const sf_transform transform) {
+    mat4 model;
+    sf_transform_model(model, transform);
+    return sf_mesh_lod_model(mesh, camera, model);
+}
+
+sf_draw_ex sf_mesh_camera_uniforms(sf_shader *shader, const sf_camera *camera) {
+    if (shader->camera_block) {
+        sf_camera_bind_block(camera);
+        return sf_draw_ex_ok();
+    }
 
     if (camera->type == SF_CAMERA_RENDER_DEFAULT) {
         mat4 identity;
         glm_mat4_identity(identity);
-        if (!sf_shader_uniform_mat4(shader, sf_lit("m_projection"), identity).is_ok)
+        if (!sf_shader_set_mat4(shader, shader->u_projection, identity).is_ok)
             return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("m_projection")});
-    } else if (!sf_shader_uniform_mat4(shader, sf_lit("m_projection"), camera->projection).is_ok)
+    } else if (!sf_shader_set_mat4(shader, shader->u_projection, camera->projection).is_ok)
         return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("m_projection")});
 
     mat4 campos;
-    sf_transform cp = camera->transform;
-    cp.position = (sf_vec3){-cp.position.x, -cp.position.y, -cp.position.z};
-    sf_transform_model(campos, cp);
-    if (!sf_shader_uniform_mat4(shader, sf_lit("m_campos"), campos).is_ok)
+    sf_camera_view(campos, camera);
+    if (!sf_shader_set_mat4(shader, shader->u_campos, campos).is_ok)
         return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("m_campos")});
+    return sf_draw_ex_ok();
+}
+
+sf_draw_ex sf_mesh_bind(sf_mesh *mesh, const sf_shader *shader, const bool instanced) {
+    sf_gl_bind_vao(sf_mesh_vao(mesh));
+    // A program that isn't linked yet has no inputs to check against.
+    if (shader->link_id == 0)
+        return sf_draw_ex_ok();
+
+    sf_mesh_check *check = NULL;
+    for (uint8_t i = 0; i < SF_MESH_CHECKS && check == NULL; ++i) {
+        if (mesh->checks[i].link_id == shader->link_id && mesh->checks[i].instanced == instanced)
+            check = mesh->checks + i;
+    }
+    if (check == NULL) {
+        check = mesh->checks + mesh->next_check;
+        mesh->next_check = (uint8_t)((mesh->next_check + 1) % SF_MESH_CHECKS);
+        const uint32_t layout = sf_vertex_layout_locations(&mesh->layout);
+        const uint32_t fed = instanced ? layout | SF_ATTRIB_INSTANCE_LOCATIONS : layout;
+        *check = (sf_mesh_check){shader->link_id, instanced, layout & shader->attrib_locations, SF_UNIFORM_NONE};
+        for (uint32_t i = 0; i < shader->attrib_count && check->missing == SF_UNIFORM_NONE; ++i) {
+            const sf_attrib_info *attrib = shader->attrib_info + i;
+            const uint32_t first = (uint32_t)attrib->location, end = first + sf_attrib_columns(attrib->type) * (uint32_t)attrib->size;
+            bool complete = sf_attrib_float(attrib->type);
+            for (uint32_t l = first; l < end && complete; ++l)
+                complete = l < 32 && (fed >> l & 1u);
+            if (!complete)
+                check->missing = i;
+        }
+    }
+    if (check->missing != SF_UNIFORM_NONE)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_ATTRIB_MISMATCH, .value.attrib_name = shader->attrib_info[check->missing].name});
+
+    // Only the streams that differ from what the vao has enabled are touched, which is none while the program stays the same.
+    uint32_t *enabled = mesh->arena ? &mesh->arena->enabled_attribs : &mesh->enabled_attribs;
+    const uint32_t changed = *enabled ^ check->attribs;
+    for (GLuint l = 0; l < 32 && changed >> l; ++l) {
+        if (!(changed >> l & 1u))
+            continue;
+        sf_gl_current->counters.issued++;
+        if (check->attribs >> l & 1u)
+            glEnableVertexAttribArray(l);
+        else glDisableVertexAttribArray(l);
+    }
+    *enabled = check->attribs;
+    return sf_draw_ex_ok();
+}
+
+/// Set the camera uniforms of a shader that is already bound, and bind the camera's framebuffer and a texture.
+/// Without a texture, the textures a material bound are left alone.
+static sf_draw_ex sf_mesh_bind_camera(sf_shader *shader, const sf_camera *camera, const sf_texture *texture) {
+    const sf_draw_ex uniforms = sf_mesh_camera_uniforms(shader, camera);
+    if (!uniforms.is_ok)
+        return uniforms;
+    if (texture && !sf_shader_set_int(shader, shader->u_sampler, 0).is_ok)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("t_sampler")});
+
+    sf_gl_bind_framebuffer(camera->framebuffer);
+    sf_gl_viewport(0, 0, (int)camera->viewport.x, (int)camera->viewport.y);
+    if (texture)
+        sf_gl_bind_texture(0, texture->handle);
+    return sf_draw_ex_ok();
+}
+
+/// Shared by both single draws; a material takes the place of the texture if it's set.
+static sf_draw_ex sf_mesh_draw_one(sf_mesh *mesh, sf_shader *shader, const sf_material *material, const sf_camera *camera,
+                                   const sf_transform transform, const sf_texture *texture) {
+    if (shader == NULL)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_SHADER_MISSING, .value.uniform_name = SF_STR_EMPTY});
 
     mat4 model;
     sf_transform_model(model, transform);
-    if (!sf_shader_uniform_mat4(shader, sf_lit("m_model"), model).is_ok)
+    const sf_frustum frustum = sf_camera_frustum(camera);
+    if (!sf_mesh_in_view(mesh, &frustum, model)) {
+        sf_gl_current->draws.culled++;
+        return sf_draw_ex_ok();
+    }
+
+    sf_mesh_update(mesh);
+    if (material)
+        sf_material_apply(material);
+    else sf_shader_bind(shader);
+
+    if (!sf_shader_set_mat4(shader, shader->u_model, model).is_ok)
         return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("m_model")});
+    const sf_draw_ex bound = sf_mesh_bind_camera(shader, camera, texture);
+    if (!bound.is_ok)
+        return bound;
 
-    if (!sf_shader_uniform_int(shader, sf_lit("t_sampler"), 0).is_ok)
-        return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("t_sampler")});
+    const sf_draw_ex attribs = sf_mesh_bind(mesh, shader, false);
+    if (!attribs.is_ok)
+        return attribs;
+    const sf_mesh_lod lod = mesh->lod_count > 0 ? mesh->lods[sf_mesh_lod_model(mesh, camera, model)] : (sf_mesh_lod){0, mesh->indices.count, 0};
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)lod.count, mesh->indices.type,
+        sf_mesh_index_offset(mesh, lod.offset), (GLint)mesh->vertex_range.offset);
+    sf_gl_current->draws.drawn++;
 
-    glBindFramebuffer(GL_FRAMEBUFFER, camera->framebuffer);
-    glViewport(0, 0, (int)camera->viewport.x, (int)camera->viewport.y);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture->handle);
-    glBindVertexArray(mesh->vao);
-    glDrawElements(GL_TRIANGLES, mesh->indices.count, GL_UNSIGNED_INT, NULL);
-    glBindVertexArray(0);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return sf_draw_ex_ok();
+}
+
+sf_draw_ex sf_mesh_draw(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform transform, const sf_texture *texture) {
+    return sf_mesh_draw_one(mesh, shader, NULL, camera, transform, texture);
+}
+
+sf_draw_ex sf_mesh_draw_material(sf_mesh *mesh, const sf_material *material, const sf_camera *camera, const sf_transform transform) {
+    return sf_mesh_draw_one(mesh, material->shader, material, camera, transform, NULL);
+}
+
+/// A model matrix as it is laid out in the instance buffer.
+typedef float sf_instance[16];
+
+/// Point the instance attributes of a mesh's vao at the instance buffer, starting from an instance.
+static void sf_mesh_instance_attribs(const size_t first) {
+    for (GLuint c = 0; c < 4; ++c) {
+        glVertexAttribPointer(SF_ATTRIB_INSTANCE + c, 4, GL_FLOAT, GL_FALSE, sizeof(sf_instance),
+            (void*)(uintptr_t)(first * sizeof(sf_instance) + c * 4 * sizeof(float)));
+    }
+}
+
+/// Make sure a mesh's instance buffer can hold count matrices, creating it on first use.
+/// The vao and the instance buffer are left bound.
+static void sf_mesh_instance_reserve(sf_mesh *mesh, const size_t count) {
+    sf_gl_bind_vao(sf_mesh_vao(mesh));
+    if (mesh->instance_vbo == 0)
+        glGenBuffers(1, &mesh->instance_vbo);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, mesh->instance_vbo);
+    // An arena's vao is shared by meshes with their own instance buffers, so it only has the attributes during a draw.
+    if (mesh->arena || mesh->instance_capacity == 0) {
+        for (GLuint c = 0; c < 4; ++c) {
+            glEnableVertexAttribArray(SF_ATTRIB_INSTANCE + c);
+            glVertexAttribDivisor(SF_ATTRIB_INSTANCE + c, 1);
+        }
+    }
+
+    size_t cap = mesh->instance_capacity < SF_MESH_MIN_CAPACITY ? SF_MESH_MIN_CAPACITY : mesh->instance_capacity;
+    while (cap < count)
+        cap *= 2;
+    mesh->instance_capacity = cap;
+    // Respecifying the storage every frame orphans the old one, so the driver never waits for the last draw to finish with it.
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(cap * sizeof(sf_instance)), NULL, GL_STREAM_DRAW);
+}
+
+/// Shared by both instanced draws; exactly one of transforms and models is set.
+static sf_draw_ex sf_mesh_draw_many(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera,
+                                    const sf_transform *transforms, mat4 *models, const size_t count, const sf_texture *texture) {
+    if (shader == NULL)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_SHADER_MISSING, .value.uniform_name = SF_STR_EMPTY});
+    if (count == 0)
+        return sf_draw_ex_ok();
+
+    // Cull and pick a level of detail for every instance, then sort the survivors by level
+    // so each level is a contiguous run of the instance buffer.
+    sf_instance *visible = malloc(count * 2 * sizeof(sf_instance));
+    sf_instance *sorted = visible + count;
+    uint8_t *levels = malloc(count);
+    size_t starts[SF_MESH_MAX_LODS + 1] = {0};
+    const sf_frustum frustum = sf_camera_frustum(camera);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; ++i) {
+        mat4 model;
+        if (transforms)
+            sf_transform_model(model, transforms[i]);
+        else glm_mat4_copy(models[i], model);
+        if (!sf_mesh_in_view(mesh, &frustum, model))
+            continue;
+        memcpy(visible[kept], model, sizeof(sf_instance));
+        levels[kept] = sf_mesh_lod_model(mesh, camera, model);
+        starts[levels[kept] + 1]++;
+        kept++;
+    }
+    sf_gl_current->draws.culled += count - kept;
+    if (kept == 0) {
+        free(levels);
+        free(visible);
+        return sf_draw_ex_ok();
+    }
+
+    for (uint8_t l = 0; l < SF_MESH_MAX_LODS; ++l)
+        starts[l + 1] += starts[l];
+    size_t next[SF_MESH_MAX_LODS];
+    memcpy(next, starts, sizeof(next));
+    for (size_t i = 0; i < kept; ++i)
+        memcpy(sorted[next[levels[i]]++], visible[i], sizeof(sf_instance));
+
+    sf_mesh_update(mesh);
+    sf_shader_bind(shader);
+    sf_draw_ex bound = sf_mesh_bind_camera(shader, camera, texture);
+    if (bound.is_ok)
+        bound = sf_mesh_bind(mesh, shader, true);
+    if (!bound.is_ok) {
+        free(levels);
+        free(visible);
+        return bound;
+    }
+
+    sf_mesh_instance_reserve(mesh, kept);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(kept * sizeof(sf_instance)), sorted);
+    for (uint8_t l = 0; l < SF_MESH_MAX_LODS; ++l) {
+        const size_t first = starts[l], n = starts[l + 1] - starts[l];
+        if (n == 0)
+            continue;
+        // GL 4.1 has no base instance, so the attributes are moved to the start of each run instead.
+        sf_mesh_instance_attribs(first);
+        const sf_mesh_lod lod = mesh->lod_count > 0 ? mesh->lods[l] : (sf_mesh_lod){0, mesh->indices.count, 0};
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)lod.count, mesh->indices.type,
+            sf_mesh_index_offset(mesh, lod.offset), (GLsizei)n, (GLint)mesh->vertex_range.offset);
+    }
+    if (mesh->arena) {
+        for (GLuint c = 0; c < 4; ++c)
+            glDisableVertexAttribArray(SF_ATTRIB_INSTANCE + c);
+    }
+    sf_gl_current->draws.drawn += kept;
 
+    free(levels);
+    free(visible);
     return sf_draw_ex_ok();
 }
+
+sf_draw_ex sf_mesh_draw_instanced(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform *transforms, const size_t count, const sf_texture *texture) {
+    return sf_mesh_draw_many(mesh, shader, camera, transforms, NULL, count, texture);
+}
+
+sf_draw_ex sf_mesh_draw_matrices(sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, mat4 *models, const size_t count, const sf_texture *texture) {
+    return sf_mesh_draw_many(mesh, shader, camera, NULL, models, count, texture);
+}
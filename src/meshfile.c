@@ -0,0 +1,269 @@
+#ifndef _WIN32
+#    define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include "sf/gfx/meshes.h"
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+static size_t sf_mesh_file_align(const size_t offset) {
+    return (offset + SF_MESH_FILE_ALIGN - 1) / SF_MESH_FILE_ALIGN * SF_MESH_FILE_ALIGN;
+}
+
+static bool sf_mesh_file_pad(FILE *file, size_t *offset) {
+    static const uint8_t zeros[SF_MESH_FILE_ALIGN] = {0};
+    const size_t aligned = sf_mesh_file_align(*offset);
+    if (fwrite(zeros, 1, aligned - *offset, file) != aligned - *offset)
+        return false;
+    *offset = aligned;
+    return true;
+}
+
+sf_mesh_save_ex sf_mesh_save(const sf_mesh *mesh, const sf_str path) {
+    if (mesh->flags & SF_MESH_FROZEN)
+        return sf_mesh_save_ex_err(SF_MESH_FILE_FROZEN);
+    sf_mesh_file_header header = {
+        .magic = SF_MESH_FILE_MAGIC,
+        .version = SF_MESH_FILE_VERSION,
+        .format = (uint32_t)mesh->layout.format,
+        .stride = mesh->layout.stride,
+        .attrib_count = mesh->layout.count,
+        .index_type = mesh->indices.type,
+        .vertex_count = mesh->vertices.count,
+        .index_count = mesh->indices.count,
+        .lod_count = mesh->lod_count,
+    };
+    for (uint8_t i = 0; i < mesh->layout.count; ++i) {
+        const sf_vertex_attrib *attrib = mesh->layout.attribs + i;
+        header.attribs[i] = (sf_mesh_file_attrib){attrib->location, (uint32_t)attrib->components, attrib->type, attrib->normalized, attrib->offset};
+    }
+    for (uint8_t i = 0; i < mesh->lod_count; ++i)
+        header.lods[i] = (sf_mesh_file_lod){mesh->lods[i].offset, mesh->lods[i].count, mesh->lods[i].error, 0};
+
+    const sf_mesh_bounds *b = &mesh->bounds;
+    memcpy(header.min, &b->min, sizeof(header.min));
+    memcpy(header.max, &b->max, sizeof(header.max));
+    memcpy(header.center, &b->center, sizeof(header.center));
+    header.radius = b->radius;
+
+    const size_t vertex_size = mesh->vertices.count * mesh->vertices.stride;
+    const size_t index_size = mesh->indices.count * sf_index_size(mesh->indices.type);
+    header.vertex_offset = sf_mesh_file_align(sizeof(header));
+    header.index_offset = sf_mesh_file_align(header.vertex_offset + vertex_size);
+
+    FILE *file = fopen(path.c_str, "wb");
+    if (!file)
+        return sf_mesh_save_ex_err(SF_MESH_FILE_WRITE_FAILURE);
+
+    size_t offset = sizeof(header);
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && sf_mesh_file_pad(file, &offset)
+        && (vertex_size == 0 || fwrite(mesh->vertices.data, 1, vertex_size, file) == vertex_size)
+        && (offset += vertex_size, sf_mesh_file_pad(file, &offset))
+        && (index_size == 0 || fwrite(mesh->indices.data, 1, index_size, file) == index_size);
+    if (fclose(file) != 0 || !written)
+        return sf_mesh_save_ex_err(SF_MESH_FILE_WRITE_FAILURE);
+    return sf_mesh_save_ex_ok();
+}
+
+/// Map a whole file read-only. Returns NULL with err set on failure.
+static void *sf_mesh_file_map(const char *path, size_t *size, sf_mesh_file_err *err) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        *err = GetLastError() == ERROR_FILE_NOT_FOUND ? SF_MESH_FILE_NOT_FOUND : SF_MESH_FILE_READ_FAILURE;
+        return NULL;
+    }
+    LARGE_INTEGER length;
+    if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+        CloseHandle(file);
+        *err = SF_MESH_FILE_INVALID;
+        return NULL;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    // The view keeps the file mapped after both handles are closed.
+    if (mapping)
+        CloseHandle(mapping);
+    CloseHandle(file);
+    if (!view) {
+        *err = SF_MESH_FILE_READ_FAILURE;
+        return NULL;
+    }
+    *size = (size_t)length.QuadPart;
+    return view;
+#else
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        *err = SF_MESH_FILE_NOT_FOUND;
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        *err = SF_MESH_FILE_INVALID;
+        return NULL;
+    }
+    void *view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        *err = SF_MESH_FILE_READ_FAILURE;
+        return NULL;
+    }
+    *size = (size_t)st.st_size;
+    return view;
+#endif
+}
+
+static void sf_mesh_file_unmap(void *view, const size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(view);
+#else
+    munmap(view, size);
+#endif
+}
+
+/// Check that a header describes a file of the given size that this version can read,
+/// and that every index in it names one of its vertices.
+static bool sf_mesh_file_valid(const sf_mesh_file_header *h, const uint8_t *view, const size_t size) {
+    if (h->attrib_count > SF_VERTEX_MAX_ATTRIBS || h->lod_count > SF_MESH_MAX_LODS || h->stride == 0)
+        return false;
+    if (h->index_type != GL_UNSIGNED_SHORT && h->index_type != GL_UNSIGNED_INT)
+        return false;
+    if (h->vertex_offset % SF_MESH_FILE_ALIGN || h->index_offset % SF_MESH_FILE_ALIGN)
+        return false;
+    if (h->vertex_offset > size || h->vertex_count > (size - h->vertex_offset) / h->stride)
+        return false;
+    if (h->index_offset > size || h->index_count > (size - h->index_offset) / sf_index_size(h->index_type))
+        return false;
+    for (uint32_t i = 0; i < h->attrib_count; ++i) {
+        if (h->attribs[i].components > 4 || h->attribs[i].offset + h->attribs[i].components * sf_gl_type_size(h->attribs[i].type) > h->stride)
+            return false;
+    }
+    for (uint32_t i = 0; i < h->lod_count; ++i) {
+        if (h->lods[i].offset > h->index_count || h->lods[i].count > h->index_count - h->lods[i].offset)
+            return false;
+    }
+    // The index blob is aligned in the mapping, so it can be read in place.
+    for (uint64_t i = 0; i < h->index_count; ++i) {
+        const uint32_t index = h->index_type == GL_UNSIGNED_SHORT
+            ? ((const uint16_t *)(view + h->index_offset))[i]
+            : ((const uint32_t *)(view + h->index_offset))[i];
+        if (index >= h->vertex_count)
+            return false;
+    }
+    return true;
+}
+
+sf_mesh_file_ex sf_mesh_load_mapped(const sf_str path) {
+    size_t size = 0;
+    sf_mesh_file_err err = SF_MESH_FILE_READ_FAILURE;
+    uint8_t *view = sf_mesh_file_map(path.c_str, &size, &err);
+    if (!view)
+        return sf_mesh_file_ex_err(err);
+
+    sf_mesh_file_header header;
+    if (size < sizeof(header)) {
+        sf_mesh_file_unmap(view, size);
+        return sf_mesh_file_ex_err(SF_MESH_FILE_INVALID);
+    }
+    memcpy(&header, view, sizeof(header));
+    if (header.magic == SF_MESH_FILE_MAGIC_SWAPPED) {
+        sf_mesh_file_unmap(view, size);
+        return sf_mesh_file_ex_err(SF_MESH_FILE_WRONG_BYTE_ORDER);
+    }
+    if (header.magic == SF_MESH_FILE_MAGIC && header.version != SF_MESH_FILE_VERSION) {
+        sf_mesh_file_unmap(view, size);
+        return sf_mesh_file_ex_err(SF_MESH_FILE_WRONG_VERSION);
+    }
+    if (header.magic != SF_MESH_FILE_MAGIC || !sf_mesh_file_valid(&header, view, size)) {
+        sf_mesh_file_unmap(view, size);
+        return sf_mesh_file_ex_err(SF_MESH_FILE_INVALID);
+    }
+
+    sf_vertex_layout layout = {.format = (sf_vertex_format)header.format};
+    for (uint32_t i = 0; i < header.attrib_count; ++i) {
+        const sf_mesh_file_attrib *attrib = header.attribs + i;
+        if (!sf_vertex_layout_push(&layout, attrib->location, (GLint)attrib->components, attrib->type, (GLboolean)attrib->normalized)) {
+            sf_mesh_file_unmap(view, size);
+            return sf_mesh_file_ex_err(SF_MESH_FILE_INVALID);
+        }
+        layout.attribs[i].offset = attrib->offset;
+    }
+    layout.stride = header.stride;
+
+    sf_mesh mesh = sf_mesh_new_layout(&layout);
+    mesh.mapping = view;
+    mesh.mapping_size = size;
+
+    // The arrays borrow the mapping; a capacity of 0 marks them as not owned.
+    mesh.vertices.data = view + header.vertex_offset;
+    mesh.vertices.count = (size_t)header.vertex_count;
+    mesh.indices.data = view + header.index_offset;
+    mesh.indices.count = (size_t)header.index_count;
+    mesh.indices.type = header.index_type;
+
+    mesh.lod_count = (uint8_t)header.lod_count;
+    for (uint32_t i = 0; i < header.lod_count; ++i)
+        mesh.lods[i] = (sf_mesh_lod){(size_t)header.lods[i].offset, (size_t)header.lods[i].count, header.lods[i].error};
+    mesh.bounds = (sf_mesh_bounds){
+        {header.min[0], header.min[1], header.min[2]},
+        {header.max[0], header.max[1], header.max[2]},
+        {header.center[0], header.center[1], header.center[2]},
+        header.radius,
+    };
+
+    // Straight from the mapping to vram; the buffers are sized exactly and grow on the first edit.
+    sf_gl_bind_vao(mesh.vao);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(mesh.vertices.count * mesh.vertices.stride), mesh.vertices.data, GL_DYNAMIC_DRAW);
+    sf_gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(mesh.indices.count * sf_index_size(mesh.indices.type)), mesh.indices.data, GL_DYNAMIC_DRAW);
+    mesh.vbo_capacity = mesh.vertices.count;
+    mesh.ebo_capacity = mesh.indices.count;
+    sf_gl_bind_vao(0);
+    sf_gl_bind_buffer(GL_ARRAY_BUFFER, 0);
+    sf_opengl_log();
+
+    return sf_mesh_file_ex_ok(mesh);
+}
+
+void sf_mesh_own(sf_mesh *mesh) {
+    if (!mesh->mapping)
+        return;
+
+    const void *vertices = mesh->vertices.data, *indices = mesh->indices.data;
+    const size_t vertex_count = mesh->vertices.count, index_count = mesh->indices.count;
+    const GLenum index_type = mesh->indices.type;
+
+    mesh->vertices = sf_vertex_data_new(mesh->layout.stride);
+    sf_vertex_data_reserve(&mesh->vertices, vertex_count);
+    if (vertex_count)
+        memcpy(mesh->vertices.data, vertices, vertex_count * mesh->vertices.stride);
+    mesh->vertices.count = vertex_count;
+
+    mesh->indices = sf_index_data_new();
+    if (index_type == GL_UNSIGNED_INT)
+        sf_index_data_widen(&mesh->indices);
+    sf_index_data_reserve(&mesh->indices, index_count);
+    if (index_count)
+        memcpy(mesh->indices.data, indices, index_count * sf_index_size(index_type));
+    mesh->indices.count = index_count;
+
+    sf_mesh_file_unmap(mesh->mapping, mesh->mapping_size);
+    mesh->mapping = NULL;
+    mesh->mapping_size = 0;
+
+    // Loading skipped deduplication, so the table is only built once the mesh actually changes.
+    sf_vertex_table_rebuild(&mesh->cache, mesh->vertices.data, mesh->vertices.stride, vertex_count);
+}
@@ -0,0 +1,348 @@
+#include <math.h>
+#include <stdlib.h>
+#include "sf/gfx/meshes.h"
+
+/// Size of the LRU cache Forsyth's scoring models. Bigger than real hardware, so it is never undershot.
+#define SF_FORSYTH_CACHE 32
+/// Clusters are only split where their local cache miss ratio stays within this factor of the whole cluster's.
+#define SF_OVERDRAW_THRESHOLD 1.05f
+
+sf_mesh_cache_stats sf_index_cache_stats(const uint32_t *indices, const size_t index_count, const size_t vertex_count, const uint32_t cache_size) {
+    sf_mesh_cache_stats stats = {0};
+    if (index_count < 3 || vertex_count == 0)
+        return stats;
+
+    // A FIFO cache, simulated by timestamping when each vertex was last transformed.
+    uint32_t *stamps = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t time = cache_size + 1, misses = 0, unique = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+        const uint32_t v = indices[i];
+        if (time - stamps[v] > cache_size) {
+            unique += stamps[v] == 0;
+            stamps[v] = time++;
+            misses++;
+        }
+    }
+    free(stamps);
+
+    stats.acmr = (float)misses / (float)(index_count / 3);
+    stats.atvr = unique ? (float)misses / (float)unique : 0;
+    return stats;
+}
+
+static float sf_forsyth_score(const int32_t position, const uint32_t live) {
+    if (live == 0)
+        return -1.0f;
+    float score = 0;
+    if (position >= 0) {
+        // The three most recent vertices were used by the last triangle, so they get a fixed score
+        // to avoid favouring strips that reuse the same edge over and over.
+        score = position < 3 ? 0.75f
+            : powf(1.0f - (float)(position - 3) / (float)(SF_FORSYTH_CACHE - 3), 1.5f);
+    }
+    // Vertices with few triangles left are finished first, so they don't get stranded.
+    return score + 2.0f * powf((float)live, -0.5f);
+}
+
+/// Reorder triangles with Tom Forsyth's linear-speed vertex cache optimisation.
+/// The triangle each fresh restart (no cached vertex to continue from) begins at is written to restarts,
+/// and their count returned; those are the hard boundaries used when sorting for overdraw.
+static size_t sf_optimize_vertex_cache(uint32_t *out, const uint32_t *indices, const size_t index_count, const size_t vertex_count, size_t *restarts) {
+    const size_t tri_count = index_count / 3;
+    uint32_t *live = calloc(vertex_count, sizeof(uint32_t));
+    uint32_t *offsets = malloc((vertex_count + 1) * sizeof(uint32_t));
+    uint32_t *adjacency = malloc(index_count * sizeof(uint32_t));
+    int32_t *positions = malloc(vertex_count * sizeof(int32_t));
+    float *vscores = malloc(vertex_count * sizeof(float));
+    bool *emitted = calloc(tri_count, sizeof(bool));
+
+    // Every vertex gets a list of the triangles that still use it.
+    for (size_t i = 0; i < index_count; ++i)
+        live[indices[i]]++;
+    offsets[0] = 0;
+    for (size_t v = 0; v < vertex_count; ++v)
+        offsets[v + 1] = offsets[v] + live[v];
+    for (size_t v = 0; v < vertex_count; ++v)
+        live[v] = 0;
+    for (size_t i = 0; i < index_count; ++i)
+        adjacency[offsets[indices[i]] + live[indices[i]]++] = (uint32_t)(i / 3);
+
+    for (size_t v = 0; v < vertex_count; ++v) {
+        positions[v] = -1;
+        vscores[v] = sf_forsyth_score(-1, live[v]);
+    }
+
+    uint32_t cache[SF_FORSYTH_CACHE + 3], next_cache[SF_FORSYTH_CACHE + 3];
+    size_t cached = 0, restart_count = 0, cursor = 0;
+    size_t best = SF_VERTEX_NONE;
+
+    for (size_t emitted_count = 0; emitted_count < tri_count; ++emitted_count) {
+        if (best == SF_VERTEX_NONE) {
+            // Nothing in the cache to continue from; start again at the first unused triangle.
+            while (emitted[cursor])
+                cursor++;
+            best = cursor;
+            restarts[restart_count++] = emitted_count;
+        }
+
+        const uint32_t *tri = indices + best * 3;
+        memcpy(out + emitted_count * 3, tri, 3 * sizeof(uint32_t));
+        emitted[best] = true;
+
+        // Remove the triangle from its vertices' lists.
+        for (size_t k = 0; k < 3; ++k) {
+            const uint32_t v = tri[k];
+            uint32_t *list = adjacency + offsets[v];
+            for (uint32_t j = 0; j < live[v]; ++j) {
+                if (list[j] == best) {
+                    list[j] = list[--live[v]];
+                    break;
+                }
+            }
+        }
+
+        // Move the triangle's vertices to the front of the cache, and push everything else back.
+        size_t next_count = 0;
+        for (size_t k = 0; k < 3; ++k)
+            next_cache[next_count++] = tri[k];
+        for (size_t j = 0; j < cached; ++j) {
+            const uint32_t v = cache[j];
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                next_cache[next_count++] = v;
+        }
+        memcpy(cache, next_cache, next_count * sizeof(uint32_t));
+        cached = next_count;
+
+        for (size_t j = 0; j < cached; ++j) {
+            const uint32_t v = cache[j];
+            positions[v] = j < SF_FORSYTH_CACHE ? (int32_t)j : -1;
+            vscores[v] = sf_forsyth_score(positions[v], live[v]);
+        }
+
+        // The next triangle is the best scoring one that touches the cache. Vertices pushed past
+        // the end of the cache were scored as uncached above, and are dropped afterwards.
+        best = SF_VERTEX_NONE;
+        float best_score = -1.0f;
+        for (size_t j = 0; j < cached; ++j) {
+            const uint32_t v = cache[j];
+            for (uint32_t a = 0; a < live[v]; ++a) {
+                const uint32_t t = adjacency[offsets[v] + a];
+                const float score = vscores[indices[t * 3]] + vscores[indices[t * 3 + 1]] + vscores[indices[t * 3 + 2]];
+                if (score > best_score) {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+        if (cached > SF_FORSYTH_CACHE)
+            cached = SF_FORSYTH_CACHE;
+    }
+
+    free(emitted);
+    free(vscores);
+    free(positions);
+    free(adjacency);
+    free(offsets);
+    free(live);
+    return restart_count;
+}
+
+typedef struct {
+    size_t start, count;
+    float sort;
+} sf_overdraw_cluster;
+
+static int sf_overdraw_compare(const void *a, const void *b) {
+    const float x = ((const sf_overdraw_cluster *)a)->sort, y = ((const sf_overdraw_cluster *)b)->sort;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+/// Sort clusters of cache-ordered triangles so those facing away from the mesh's centre are drawn first.
+/// Outward facing clusters tend to occlude the rest from any viewpoint, which cuts overdraw without
+/// knowing the camera. Clusters are split further wherever that doesn't hurt the cache.
+static void sf_optimize_overdraw(uint32_t *indices, const size_t index_count, const sf_vec3 *positions, const size_t vertex_count,
+                                 const size_t *restarts, const size_t restart_count) {
+    const size_t tri_count = index_count / 3;
+    sf_overdraw_cluster *clusters = malloc(tri_count * sizeof(sf_overdraw_cluster));
+    uint32_t *stamps = calloc(vertex_count, sizeof(uint32_t));
+    size_t cluster_count = 0;
+    uint32_t time = 0;
+
+    for (size_t r = 0; r < restart_count; ++r) {
+        const size_t start = restarts[r], end = r + 1 < restart_count ? restarts[r + 1] : tri_count;
+
+        // The miss ratio of the whole hard cluster, from a cold cache.
+        time += SF_FORSYTH_CACHE + 1;
+        size_t misses = 0;
+        for (size_t i = start * 3; i < end * 3; ++i) {
+            if (time - stamps[indices[i]] > SF_FORSYTH_CACHE) {
+                stamps[indices[i]] = time++;
+                misses++;
+            }
+        }
+        const float limit = (float)misses / (float)(end - start) * SF_OVERDRAW_THRESHOLD;
+
+        time += SF_FORSYTH_CACHE + 1;
+        size_t soft = start;
+        misses = 0;
+        for (size_t t = start; t < end; ++t) {
+            for (size_t i = t * 3; i < t * 3 + 3; ++i) {
+                if (time - stamps[indices[i]] > SF_FORSYTH_CACHE) {
+                    stamps[indices[i]] = time++;
+                    misses++;
+                }
+            }
+            if (t + 1 == end || (float)misses / (float)(t + 1 - soft) <= limit) {
+                clusters[cluster_count++] = (sf_overdraw_cluster){soft, t + 1 - soft, 0};
+                soft = t + 1;
+                misses = 0;
+                time += SF_FORSYTH_CACHE + 1;
+            }
+        }
+    }
+    free(stamps);
+
+    sf_vec3 center = {0, 0, 0};
+    for (size_t v = 0; v < vertex_count; ++v) {
+        center.x += positions[v].x;
+        center.y += positions[v].y;
+        center.z += positions[v].z;
+    }
+    if (vertex_count) {
+        center.x /= (float)vertex_count;
+        center.y /= (float)vertex_count;
+        center.z /= (float)vertex_count;
+    }
+
+    for (size_t c = 0; c < cluster_count; ++c) {
+        // Area weighted centroid and normal of the cluster.
+        sf_vec3 centroid = {0, 0, 0}, normal = {0, 0, 0};
+        float area = 0;
+        for (size_t t = clusters[c].start; t < clusters[c].start + clusters[c].count; ++t) {
+            const sf_vec3 a = positions[indices[t * 3]], b = positions[indices[t * 3 + 1]], d = positions[indices[t * 3 + 2]];
+            const sf_vec3 e1 = {b.x - a.x, b.y - a.y, b.z - a.z}, e2 = {d.x - a.x, d.y - a.y, d.z - a.z};
+            const sf_vec3 n = {e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x};
+            const float w = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+            centroid.x += (a.x + b.x + d.x) / 3.0f * w;
+            centroid.y += (a.y + b.y + d.y) / 3.0f * w;
+            centroid.z += (a.z + b.z + d.z) / 3.0f * w;
+            normal.x += n.x;
+            normal.y += n.y;
+            normal.z += n.z;
+            area += w;
+        }
+        const float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        if (area > 0 && length > 0) {
+            clusters[c].sort = ((centroid.x / area - center.x) * normal.x
+                + (centroid.y / area - center.y) * normal.y
+                + (centroid.z / area - center.z) * normal.z) / length;
+        }
+    }
+
+    qsort(clusters, cluster_count, sizeof(sf_overdraw_cluster), sf_overdraw_compare);
+
+    uint32_t *sorted = malloc(index_count * sizeof(uint32_t));
+    size_t written = 0;
+    for (size_t c = 0; c < cluster_count; ++c) {
+        memcpy(sorted + written, indices + clusters[c].start * 3, clusters[c].count * 3 * sizeof(uint32_t));
+        written += clusters[c].count * 3;
+    }
+    memcpy(indices, sorted, index_count * sizeof(uint32_t));
+    free(sorted);
+    free(clusters);
+}
+
+/// Renumber vertices in the order they are first used, so vertex fetches walk memory forwards.
+/// Unused vertices keep their relative order at the end. Returns the old to new index mapping.
+static uint32_t *sf_optimize_vertex_fetch(sf_vertex_data *vertices, uint32_t *indices, const size_t index_count) {
+    const size_t count = vertices->count, stride = vertices->stride;
+    uint32_t *remap = malloc(count * sizeof(uint32_t));
+    for (size_t v = 0; v < count; ++v)
+        remap[v] = SF_VERTEX_NONE;
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < index_count; ++i) {
+        if (remap[indices[i]] == SF_VERTEX_NONE)
+            remap[indices[i]] = next++;
+        indices[i] = remap[indices[i]];
+    }
+    for (size_t v = 0; v < count; ++v) {
+        if (remap[v] == SF_VERTEX_NONE)
+            remap[v] = next++;
+    }
+
+    uint8_t *data = malloc(vertices->capacity * stride);
+    for (size_t v = 0; v < count; ++v)
+        memcpy(data + (size_t)remap[v] * stride, vertices->data + v * stride, stride);
+    free(vertices->data);
+    vertices->data = data;
+    return remap;
+}
+
+void sf_index_optimize_cache(uint32_t *indices, const size_t index_count, const size_t vertex_count) {
+    if (index_count < 3)
+        return;
+    uint32_t *optimized = malloc(index_count * sizeof(uint32_t));
+    size_t *restarts = malloc(index_count / 3 * sizeof(size_t));
+    sf_optimize_vertex_cache(optimized, indices, index_count - index_count % 3, vertex_count, restarts);
+    memcpy(indices, optimized, (index_count - index_count % 3) * sizeof(uint32_t));
+    free(restarts);
+    free(optimized);
+}
+
+sf_mesh_cache_stats sf_mesh_cache_stats_get(const sf_mesh *mesh, const uint32_t cache_size) {
+    if (mesh->flags & SF_MESH_FROZEN)
+        return (sf_mesh_cache_stats){0};
+    uint32_t *indices = malloc(mesh->indices.count * sizeof(uint32_t));
+    for (size_t i = 0; i < mesh->indices.count; ++i)
+        indices[i] = sf_index_data_get(&mesh->indices, i);
+    const sf_mesh_cache_stats stats = sf_index_cache_stats(indices, mesh->indices.count, mesh->vertices.count, cache_size);
+    free(indices);
+    return stats;
+}
+
+sf_mesh_optimize_report sf_mesh_optimize(sf_mesh *mesh, const sf_optimize_flags flags) {
+    sf_mesh_optimize_report report = {0};
+    if (mesh->flags & SF_MESH_FROZEN)
+        return report;
+    sf_mesh_own(mesh);
+    sf_mesh_lod_clear(mesh);
+    const size_t index_count = mesh->indices.count - mesh->indices.count % 3;
+    const size_t vertex_count = mesh->vertices.count;
+    if (index_count < 3)
+        return report;
+
+    uint32_t *indices = malloc(index_count * sizeof(uint32_t));
+    uint32_t *optimized = malloc(index_count * sizeof(uint32_t));
+    size_t *restarts = malloc(index_count / 3 * sizeof(size_t));
+    for (size_t i = 0; i < index_count; ++i)
+        indices[i] = sf_index_data_get(&mesh->indices, i);
+    report.before = sf_index_cache_stats(indices, index_count, vertex_count, SF_MESH_CACHE_SIZE);
+
+    const size_t restart_count = sf_optimize_vertex_cache(optimized, indices, index_count, vertex_count, restarts);
+    if (flags & SF_OPTIMIZE_OVERDRAW) {
+        sf_vec3 *positions = malloc(vertex_count * sizeof(sf_vec3));
+        sf_vertex_positions(&mesh->layout, mesh->vertices.data, vertex_count, positions);
+        sf_optimize_overdraw(optimized, index_count, positions, vertex_count, restarts, restart_count);
+        free(positions);
+    }
+    free(sf_optimize_vertex_fetch(&mesh->vertices, optimized, index_count));
+
+    // Indices keep their width; renumbering can't make any of them bigger.
+    for (size_t i = 0; i < index_count; ++i) {
+        if (mesh->indices.type == GL_UNSIGNED_SHORT)
+            ((uint16_t *)mesh->indices.data)[i] = (uint16_t)optimized[i];
+        else ((uint32_t *)mesh->indices.data)[i] = optimized[i];
+    }
+    report.after = sf_index_cache_stats(optimized, index_count, vertex_count, SF_MESH_CACHE_SIZE);
+
+    // Vertices moved, so the deduplication table has to point at their new slots.
+    sf_vertex_table_rebuild(&mesh->cache, mesh->vertices.data, mesh->vertices.stride, vertex_count);
+    mesh->dirty_vertices = (sf_mesh_range){0, vertex_count};
+    mesh->dirty_indices = (sf_mesh_range){0, mesh->indices.count};
+
+    free(restarts);
+    free(optimized);
+    free(indices);
+    return report;
+}
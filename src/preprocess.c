@@ -0,0 +1,226 @@
+#include <stdlib.h>
+#include <sf/math.h>
+#include <sf/fs.h>
+#include "sf/gfx/shaders.h"
+
+/// A source being built.
+typedef struct {
+    char *data;
+    size_t length, capacity;
+} sf_source;
+
+static void sf_source_append(sf_source *source, const char *text, const size_t length) {
+    if (source->length + length + 1 > source->capacity) {
+        size_t capacity = source->capacity ? source->capacity * 2 : 1024;
+        while (capacity < source->length + length + 1)
+            capacity *= 2;
+        source->data = realloc(source->data, capacity);
+        source->capacity = capacity;
+    }
+    memcpy(source->data + source->length, text, length);
+    source->length += length;
+    source->data[source->length] = '\0';
+}
+
+/// Tables of embedded files, searched before the disk.
+static struct {
+    const sf_shader_file *files;
+    size_t count;
+} *sf_embedded = NULL;
+static size_t sf_embedded_count = 0;
+
+void sf_shader_embed(const sf_shader_file *files, const size_t count) {
+    sf_embedded = realloc(sf_embedded, (sf_embedded_count + 1) * sizeof(*sf_embedded));
+    sf_embedded[sf_embedded_count].files = files;
+    sf_embedded[sf_embedded_count].count = count;
+    sf_embedded_count++;
+}
+
+/// Read a whole file, or the embedded file at its path if embedded is set, null terminated. Returns NULL if it can't be read.
+static char *sf_source_read(const sf_str path, const bool embedded) {
+    // Later tables take the place of earlier ones.
+    for (size_t t = embedded ? sf_embedded_count : 0; t-- > 0;) {
+        for (size_t i = 0; i < sf_embedded[t].count; ++i) {
+            const sf_shader_file *file = sf_embedded[t].files + i;
+            if (strcmp(file->path, path.c_str) != 0)
+                continue;
+            char *copy = malloc(file->size + 1);
+            memcpy(copy, file->source, file->size);
+            copy[file->size] = '\0';
+            return copy;
+        }
+    }
+
+    const long size = sf_file_size(path);
+    if (size <= 0)
+        return NULL;
+    uint8_t *buffer = malloc((size_t)size + 1);
+    if (!sf_load_file(buffer, path).is_ok) {
+        free(buffer);
+        return NULL;
+    }
+    buffer[size] = '\0';
+    return (char *)buffer;
+}
+
+/// Get the directory part of a path, "/" for a file at the root, or an empty string if it has none.
+static sf_str sf_source_dir(const sf_str path) {
+    size_t end = path.len;
+    while (end > 0 && path.c_str[end - 1] != '/' && path.c_str[end - 1] != '\\')
+        end--;
+    if (end == 1)
+        return sf_str_fmt("%c", path.c_str[0]);
+    return end > 0 ? sf_str_fmt("%.*s", (int)(end - 1), path.c_str) : sf_str_fmt("");
+}
+
+/// Paths already included into a source, each of which is only expanded once.
+typedef struct {
+    sf_str *paths;
+    size_t count;
+} sf_source_includes;
+
+static bool sf_source_included(sf_source_includes *includes, const sf_str path) {
+    for (size_t i = 0; i < includes->count; ++i)
+        if (strcmp(includes->paths[i].c_str, path.c_str) == 0)
+            return true;
+    includes->paths = realloc(includes->paths, (includes->count + 1) * sizeof(sf_str));
+    includes->paths[includes->count++] = sf_str_dup(path);
+    return false;
+}
+
+/// Whether a line ends inside a block comment, given whether it started in one.
+static bool sf_source_in_comment(const char *line, const size_t length, bool in_comment) {
+    for (size_t i = 0; i + 1 < length; ++i) {
+        if (in_comment && line[i] == '*' && line[i + 1] == '/') {
+            in_comment = false;
+            i++;
+        } else if (!in_comment && line[i] == '/' && line[i + 1] == '/')
+            break;
+        else if (!in_comment && line[i] == '/' && line[i + 1] == '*') {
+            in_comment = true;
+            i++;
+        }
+    }
+    return in_comment;
+}
+
+/// Append a source to another, replacing its #include lines with the files they name.
+static bool sf_source_expand(sf_source *out, const char *text, const sf_str dir, const int depth, const bool embedded,
+                             sf_source_includes *includes, sf_shader_err *err) {
+    bool in_comment = false;
+    for (const char *line = text; *line;) {
+        const char *newline = strchr(line, '\n');
+        const size_t length = newline ? (size_t)(newline - line) + 1 : strlen(line);
+        const bool commented = in_comment;
+        in_comment = sf_source_in_comment(line, length, in_comment);
+        const char *c = line;
+        while (*c == ' ' || *c == '\t')
+            c++;
+        if (commented || strncmp(c, "#include", 8) != 0) {
+            sf_source_append(out, line, length);
+            line += length;
+            continue;
+        }
+
+        const char *open = memchr(c, '"', length - (size_t)(c - line));
+        const char *close = open ? memchr(open + 1, '"', length - (size_t)(open + 1 - line)) : NULL;
+        if (close == NULL) {
+            *err = (sf_shader_err){SF_SHADER_COMPILE_ERROR, sf_str_fmt("Malformed include: %.*s", (int)(length - (size_t)(c - line)), c)};
+            return false;
+        }
+        if (depth >= SF_SHADER_INCLUDE_DEPTH) {
+            *err = (sf_shader_err){SF_SHADER_COMPILE_ERROR, sf_str_fmt("Includes nest deeper than %d at '%.*s'", SF_SHADER_INCLUDE_DEPTH, (int)(close - open - 1), open + 1)};
+            return false;
+        }
+
+        const bool separated = dir.len == 0 || dir.c_str[dir.len - 1] == '/' || dir.c_str[dir.len - 1] == '\\';
+        const sf_str path = sf_str_fmt("%s%s%.*s", dir.c_str, separated ? "" : "/", (int)(close - open - 1), open + 1);
+        if (sf_source_included(includes, path)) {
+            sf_str_free(path);
+            line += length;
+            continue;
+        }
+        char *included = sf_source_read(path, embedded);
+        if (included == NULL) {
+            *err = (sf_shader_err){SF_SHADER_NOT_FOUND, sf_str_fmt("Can't read shader include '%s'", path.c_str)};
+            sf_str_free(path);
+            return false;
+        }
+        const sf_str included_dir = sf_source_dir(path);
+        const bool expanded = sf_source_expand(out, included, included_dir, depth + 1, embedded, includes, err);
+        sf_str_free(included_dir);
+        sf_str_free(path);
+        free(included);
+        if (!expanded)
+            return false;
+        // The included file may not end its last line.
+        if (out->length && out->data[out->length - 1] != '\n')
+            sf_source_append(out, "\n", 1);
+        line += length;
+    }
+    return true;
+}
+
+/// Expand a source like sf_shader_preprocess, reading includes from the embedded files only if embedded is set.
+static sf_source_ex sf_source_preprocess(const char *source, const sf_str dir, const char *defines, const bool embedded) {
+    sf_source out = {0};
+    sf_source_includes includes = {0};
+    sf_shader_err err;
+    const bool expanded = sf_source_expand(&out, source, dir, 0, embedded, &includes, &err);
+    for (size_t i = 0; i < includes.count; ++i)
+        sf_str_free(includes.paths[i]);
+    free(includes.paths);
+    if (!expanded) {
+        free(out.data);
+        return sf_source_ex_err(err);
+    }
+    if (out.data == NULL)
+        sf_source_append(&out, "", 0);
+    if (defines == NULL || *defines == '\0')
+        return sf_source_ex_ok(out.data);
+
+    // Nothing but comments can come before #version, so the defines go right after it.
+    size_t at = 0;
+    for (const char *line = out.data; line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        const char *c = line;
+        while (*c == ' ' || *c == '\t')
+            c++;
+        if (strncmp(c, "#version", 8) == 0) {
+            const char *end = strchr(c, '\n');
+            at = end ? (size_t)(end + 1 - out.data) : out.length;
+            break;
+        }
+    }
+    sf_source with = {0};
+    sf_source_append(&with, out.data, at);
+    if (at && with.data[at - 1] != '\n')
+        sf_source_append(&with, "\n", 1);
+    sf_source_append(&with, defines, strlen(defines));
+    sf_source_append(&with, out.data + at, out.length - at);
+    free(out.data);
+    return sf_source_ex_ok(with.data);
+}
+
+sf_source_ex sf_shader_preprocess(const char *source, const sf_str dir, const char *defines) {
+    return sf_source_preprocess(source, dir, defines, true);
+}
+
+/// Read and expand a file, from the embedded files only if embedded is set.
+static sf_source_ex sf_source_file(const sf_str path, const char *defines, const bool embedded) {
+    char *text = sf_source_read(path, embedded);
+    if (text == NULL)
+        return sf_source_ex_err((sf_shader_err){SF_SHADER_NOT_FOUND, SF_STR_EMPTY});
+    const sf_str dir = sf_source_dir(path);
+    const sf_source_ex out = sf_source_preprocess(text, dir, defines, embedded);
+    sf_str_free(dir);
+    free(text);
+    return out;
+}
+
+sf_source_ex sf_shader_source(const sf_str path, const char *defines) {
+    return sf_source_file(path, defines, true);
+}
+
+sf_source_ex sf_shader_source_disk(const sf_str path, const char *defines) {
+    return sf_source_file(path, defines, false);
+}
@@ -0,0 +1,162 @@
+#include <math.h>
+#include <stdlib.h>
+#include "sf/gfx/queue.h"
+
+sf_render_queue sf_render_queue_new(void) {
+    return (sf_render_queue){0};
+}
+
+void sf_render_queue_free(sf_render_queue *queue) {
+    free(queue->cmds);
+    free(queue->items);
+    free(queue->scratch);
+    *queue = (sf_render_queue){0};
+}
+
+/// Shared by both pushes; a material takes the place of the texture if it's set.
+static void sf_render_queue_add(sf_render_queue *queue, sf_mesh *mesh, sf_shader *shader, const sf_camera *camera,
+                                const sf_transform transform, const sf_texture *texture, const sf_material *material) {
+    mat4 model;
+    sf_transform_model(model, transform);
+    const sf_frustum frustum = sf_camera_frustum(camera);
+    if (!sf_mesh_in_view(mesh, &frustum, model)) {
+        sf_draw_stats_count(0, 1);
+        return;
+    }
+
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 256;
+        queue->cmds = realloc(queue->cmds, queue->capacity * sizeof(sf_render_cmd));
+        queue->items = realloc(queue->items, queue->capacity * sizeof(sf_render_item));
+        queue->scratch = realloc(queue->scratch, queue->capacity * sizeof(sf_render_item));
+    }
+
+    float depth = 0.0f;
+    if (camera->type != SF_CAMERA_RENDER_DEFAULT && camera->far > 0) {
+        vec3 center = {mesh->bounds.center.x, mesh->bounds.center.y, mesh->bounds.center.z};
+        glm_mat4_mulv3(model, center, 1.0f, center);
+        const sf_vec3 eye = camera->transform.position;
+        const float dx = center[0] - eye.x, dy = center[1] - eye.y, dz = center[2] - eye.z;
+        depth = sqrtf(dx * dx + dy * dy + dz * dz) / camera->far;
+    }
+
+    sf_render_cmd *cmd = queue->cmds + queue->count;
+    *cmd = (sf_render_cmd){mesh, shader, camera, texture, material, {0}, sf_mesh_lod_model(mesh, camera, model)};
+    memcpy(cmd->model, model, sizeof(cmd->model));
+    queue->items[queue->count] = (sf_render_item){
+        sf_render_key(camera->framebuffer, shader ? shader->program : 0, material ? material->sort_id : texture->handle, sf_mesh_vao(mesh), depth),
+        (uint32_t)queue->count,
+    };
+    queue->count++;
+}
+
+void sf_render_queue_push(sf_render_queue *queue, sf_mesh *mesh, sf_shader *shader, const sf_camera *camera, const sf_transform transform, const sf_texture *texture) {
+    sf_render_queue_add(queue, mesh, shader, camera, transform, texture, NULL);
+}
+
+void sf_render_queue_push_material(sf_render_queue *queue, sf_mesh *mesh, const sf_material *material, const sf_camera *camera, const sf_transform transform) {
+    sf_render_queue_add(queue, mesh, material->shader, camera, transform, NULL, material);
+}
+
+void sf_render_queue_sort(sf_render_queue *queue) {
+    // Least significant byte first. A pass where every key has the same byte wouldn't move anything.
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = {0};
+        for (size_t i = 0; i < queue->count; ++i)
+            offsets[(queue->items[i].key >> shift) & 0xFF]++;
+        if (queue->count == 0 || offsets[(queue->items[0].key >> shift) & 0xFF] == queue->count)
+            continue;
+
+        size_t sum = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            const size_t n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
+        }
+        for (size_t i = 0; i < queue->count; ++i)
+            queue->scratch[offsets[(queue->items[i].key >> shift) & 0xFF]++] = queue->items[i];
+
+        sf_render_item *swap = queue->items;
+        queue->items = queue->scratch;
+        queue->scratch = swap;
+    }
+}
+
+/// What the previous draw of a flush left bound, so the next one only changes what differs.
+typedef struct {
+    const sf_shader *shader;
+    const sf_material *material;
+    const sf_camera *camera;
+} sf_render_bound;
+
+/// Draw one command of a flush. Binds go through the state cache, which drops the ones the previous draw already made.
+/// Only uniforms are tracked here, since they belong to the program.
+static sf_draw_ex sf_render_cmd_draw(const sf_render_cmd *cmd, sf_render_bound *bound) {
+    if (cmd->shader == NULL)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_SHADER_MISSING, .value.uniform_name = SF_STR_EMPTY});
+
+    // A material sets its own samplers, which a draw without one resets.
+    if (cmd->shader != bound->shader || cmd->material != bound->material) {
+        if (cmd->shader != bound->shader)
+            bound->camera = NULL;
+        bound->shader = cmd->shader;
+        bound->material = cmd->material;
+        if (cmd->material)
+            sf_material_apply(cmd->material);
+        else sf_shader_bind(cmd->shader);
+        if (!cmd->material && !sf_shader_set_int(cmd->shader, cmd->shader->u_sampler, 0).is_ok)
+            return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("t_sampler")});
+    }
+    if (cmd->camera != bound->camera) {
+        bound->camera = cmd->camera;
+        const sf_draw_ex uniforms = sf_mesh_camera_uniforms(cmd->shader, cmd->camera);
+        if (!uniforms.is_ok)
+            return uniforms;
+    }
+    sf_gl_bind_framebuffer(cmd->camera->framebuffer);
+    sf_gl_viewport(0, 0, (int)cmd->camera->viewport.x, (int)cmd->camera->viewport.y);
+    if (cmd->texture)
+        sf_gl_bind_texture(0, cmd->texture->handle);
+    const sf_draw_ex bind = sf_mesh_bind(cmd->mesh, cmd->shader, false);
+    if (!bind.is_ok)
+        return bind;
+
+    mat4 model;
+    memcpy(model, cmd->model, sizeof(cmd->model));
+    if (!sf_shader_set_mat4(cmd->shader, cmd->shader->u_model, model).is_ok)
+        return sf_draw_ex_err((sf_draw_err){SF_DRAW_UNKNOWN_UNIFORM, .value.uniform_name = sf_lit("m_model")});
+
+    const sf_mesh *mesh = cmd->mesh;
+    // The levels may have been dropped by an edit since the draw was queued.
+    const sf_mesh_lod lod = cmd->lod < mesh->lod_count ? mesh->lods[cmd->lod] : (sf_mesh_lod){0, mesh->indices.count, 0};
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)lod.count, mesh->indices.type,
+        sf_mesh_index_offset(mesh, lod.offset), (GLint)mesh->vertex_range.offset);
+    return sf_draw_ex_ok();
+}
+
+sf_draw_ex sf_render_queue_flush(sf_render_queue *queue) {
+    sf_render_queue_sort(queue);
+
+    // Uploads bind their own buffers, so they all happen before any state is tracked.
+    for (size_t i = 0; i < queue->count; ++i)
+        sf_mesh_update(queue->cmds[i].mesh);
+
+    // A failed draw is skipped like it would be by sf_mesh_draw, and the rest of the queue still draws.
+    sf_draw_ex result = sf_draw_ex_ok();
+    sf_render_bound bound = {NULL, NULL, NULL};
+    size_t drawn = 0;
+    for (size_t i = 0; i < queue->count; ++i) {
+        const sf_draw_ex draw = sf_render_cmd_draw(queue->cmds + queue->items[i].index, &bound);
+        if (draw.is_ok) {
+            drawn++;
+            continue;
+        }
+        if (result.is_ok)
+            result = draw;
+        // It may have failed halfway through binding, so the next draw binds everything again.
+        bound = (sf_render_bound){NULL, NULL, NULL};
+    }
+    sf_draw_stats_count(drawn, 0);
+    queue->count = 0;
+    return result;
+}
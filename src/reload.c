@@ -0,0 +1,364 @@
+#ifdef __linux__
+#    define _POSIX_C_SOURCE 200809L
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include "sf/gfx/reload.h"
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "stb/stb_image.h"
+#include "threads.h"
+
+/// What the watcher read for an asset, waiting to be applied.
+typedef struct {
+    char *vertex, *fragment;
+    uint8_t *pixels;
+    int width, height;
+} sf_reload_result;
+
+/// A watched shader or texture, and the reload it's waiting on.
+typedef struct {
+    void *asset;
+    bool texture;
+    /// The watch on the asset's directory, the path it's read from, and the name its files are matched by:
+    /// a shader's path without its directory, or a texture's file name.
+    int watch;
+    sf_str path, name;
+    /// Set when one of its files changed, until the watcher reads it again.
+    bool dirty;
+    sf_reload_result result;
+    /// A program compiling to take the shader's place.
+    sf_shader next;
+    bool compiling;
+} sf_reload_entry;
+
+struct sf_reloader {
+    int inotify;
+    /// Closing the write end wakes the watcher up to stop.
+    int wake[2];
+    sf_thread thread;
+    /// Guards the entries, which the watcher marks and fills.
+    sf_mutex lock;
+    sf_reload_entry **entries;
+    size_t count, capacity;
+};
+
+static void sf_reload_result_free(sf_reload_result *result) {
+    free(result->vertex);
+    free(result->fragment);
+    if (result->pixels)
+        stbi_image_free(result->pixels);
+    *result = (sf_reload_result){0};
+}
+
+/// Whether a changed file belongs to an asset: a texture's own file, a shader's stages, or a .glsl file next to them.
+static bool sf_reload_matches(const sf_reload_entry *entry, const char *file) {
+    if (entry->texture)
+        return strcmp(file, entry->name.c_str) == 0;
+    const char *dot = strrchr(file, '.');
+    if (dot == NULL)
+        return false;
+    if (strcmp(dot, ".glsl") == 0)
+        return true;
+    if (strcmp(dot, ".vert") != 0 && strcmp(dot, ".frag") != 0)
+        return false;
+    return (size_t)(dot - file) == entry->name.len && strncmp(file, entry->name.c_str, entry->name.len) == 0;
+}
+
+/// Find the entry of an asset. The lock must be held.
+static sf_reload_entry *sf_reloader_find(const sf_reloader *reloader, const void *asset) {
+    for (size_t i = 0; i < reloader->count; ++i) {
+        if (reloader->entries[i]->asset == asset)
+            return reloader->entries[i];
+    }
+    return NULL;
+}
+
+/// Read both stages of a shader from disk, expanded.
+static sf_reload_result sf_reload_shader(const sf_str path) {
+    sf_reload_result out = {0};
+    for (int i = 0; i < 2; ++i) {
+        const sf_str spath = sf_str_fmt("%s.%s", path.c_str, i ? "frag" : "vert");
+        const sf_source_ex source = sf_shader_source_disk(spath, NULL);
+        if (source.is_ok) {
+            *(i ? &out.fragment : &out.vertex) = source.value.ok;
+        } else {
+            fprintf(stderr, "Can't reload shader '%s': %s\n", spath.c_str,
+                source.value.err.compile_err.c_str ? source.value.err.compile_err.c_str : "file not found");
+            if (source.value.err.compile_err.c_str)
+                sf_str_free(source.value.err.compile_err);
+        }
+        sf_str_free(spath);
+    }
+    if (out.vertex == NULL || out.fragment == NULL)
+        sf_reload_result_free(&out);
+    return out;
+}
+
+/// Decode a texture from disk, flipped like sf_texture_load does.
+static sf_reload_result sf_reload_texture(const sf_str path) {
+    sf_reload_result out = {0};
+    int channels;
+    stbi_set_flip_vertically_on_load_thread(1);
+    out.pixels = stbi_load(path.c_str, &out.width, &out.height, &channels, 4 /* RGBA */);
+    if (out.pixels == NULL)
+        fprintf(stderr, "Can't reload texture '%s': %s\n", path.c_str, stbi_failure_reason());
+    return out;
+}
+
+/// Read every asset marked as changed, one at a time outside of the lock, and leave what was read for sf_reloader_apply.
+static void sf_reloader_load(sf_reloader *reloader) {
+    for (;;) {
+        sf_mutex_lock(&reloader->lock);
+        sf_reload_entry *entry = NULL;
+        for (size_t i = 0; i < reloader->count && entry == NULL; ++i) {
+            if (reloader->entries[i]->dirty)
+                entry = reloader->entries[i];
+        }
+        if (entry == NULL) {
+            sf_mutex_unlock(&reloader->lock);
+            return;
+        }
+        entry->dirty = false;
+        const void *asset = entry->asset;
+        const bool texture = entry->texture;
+        const sf_str path = sf_str_dup(entry->path);
+        sf_mutex_unlock(&reloader->lock);
+
+        sf_reload_result result = texture ? sf_reload_texture(path) : sf_reload_shader(path);
+        sf_str_free(path);
+
+        // The asset may have been forgotten while it was read, and an older read that wasn't applied yet is stale.
+        sf_mutex_lock(&reloader->lock);
+        entry = sf_reloader_find(reloader, asset);
+        if (entry != NULL && (result.vertex || result.pixels)) {
+            sf_reload_result_free(&entry->result);
+            entry->result = result;
+        } else sf_reload_result_free(&result);
+        sf_mutex_unlock(&reloader->lock);
+    }
+}
+
+/// The watcher thread, which waits for changes and reads the assets they belong to.
+static void sf_reloader_run(void *arg) {
+    sf_reloader *reloader = arg;
+    struct pollfd fds[2] = {{reloader->inotify, POLLIN, 0}, {reloader->wake[0], POLLIN, 0}};
+    union {
+        struct inotify_event event;
+        char bytes[4096];
+    } buffer;
+    for (;;) {
+        if (poll(fds, 2, -1) < 0)
+            continue;
+        if (fds[1].revents != 0)
+            return;
+
+        const ssize_t length = read(reloader->inotify, buffer.bytes, sizeof(buffer.bytes));
+        if (length <= 0)
+            continue;
+        sf_mutex_lock(&reloader->lock);
+        for (ssize_t at = 0; at < length;) {
+            const struct inotify_event *event = (const struct inotify_event *)(void *)(buffer.bytes + at);
+            for (size_t i = 0; i < reloader->count && event->len; ++i) {
+                sf_reload_entry *entry = reloader->entries[i];
+                if (entry->watch == event->wd && sf_reload_matches(entry, event->name))
+                    entry->dirty = true;
+            }
+            at += (ssize_t)(sizeof(struct inotify_event) + event->len);
+        }
+        sf_mutex_unlock(&reloader->lock);
+        sf_reloader_load(reloader);
+    }
+}
+
+sf_reloader *sf_reloader_new(void) {
+    sf_reloader *reloader = calloc(1, sizeof(sf_reloader));
+    reloader->inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader->inotify < 0) {
+        free(reloader);
+        return NULL;
+    }
+    if (pipe(reloader->wake) != 0) {
+        close(reloader->inotify);
+        free(reloader);
+        return NULL;
+    }
+    sf_mutex_init(&reloader->lock);
+    if (!sf_thread_start(&reloader->thread, sf_reloader_run, reloader)) {
+        sf_mutex_free(&reloader->lock);
+        close(reloader->wake[0]);
+        close(reloader->wake[1]);
+        close(reloader->inotify);
+        free(reloader);
+        return NULL;
+    }
+    return reloader;
+}
+
+/// Free an entry, and remove the watch on its directory if no other entry uses it. The lock must be held.
+static void sf_reloader_remove(sf_reloader *reloader, const size_t index) {
+    sf_reload_entry *entry = reloader->entries[index];
+    memmove(reloader->entries + index, reloader->entries + index + 1, (reloader->count - index - 1) * sizeof(sf_reload_entry *));
+    reloader->count--;
+
+    bool shared = false;
+    for (size_t i = 0; i < reloader->count && !shared; ++i)
+        shared = reloader->entries[i]->watch == entry->watch;
+    if (!shared)
+        inotify_rm_watch(reloader->inotify, entry->watch);
+
+    if (entry->compiling)
+        sf_shader_free(&entry->next);
+    sf_reload_result_free(&entry->result);
+    sf_str_free(entry->path);
+    sf_str_free(entry->name);
+    free(entry);
+}
+
+void sf_reloader_free(sf_reloader *reloader) {
+    if (reloader == NULL)
+        return;
+    close(reloader->wake[1]);
+    sf_thread_join(&reloader->thread);
+    while (reloader->count)
+        sf_reloader_remove(reloader, reloader->count - 1);
+    free(reloader->entries);
+    sf_mutex_free(&reloader->lock);
+    close(reloader->wake[0]);
+    close(reloader->inotify);
+    free(reloader);
+}
+
+/// Watch the directory of an asset's path, and match its files by the rest of the path.
+static bool sf_reloader_watch(sf_reloader *reloader, void *asset, const bool texture, const sf_str path) {
+    if (reloader == NULL || path.c_str == NULL || path.len == 0)
+        return false;
+    sf_reloader_forget(reloader, asset);
+
+    const char *slash = strrchr(path.c_str, '/');
+    const sf_str dir = slash == path.c_str ? sf_str_fmt("/")
+        : slash ? sf_str_fmt("%.*s", (int)(slash - path.c_str), path.c_str) : sf_str_fmt(".");
+    const int watch = inotify_add_watch(reloader->inotify, dir.c_str, IN_CLOSE_WRITE | IN_MOVED_TO);
+    sf_str_free(dir);
+    if (watch < 0)
+        return false;
+
+    sf_reload_entry *entry = calloc(1, sizeof(sf_reload_entry));
+    *entry = (sf_reload_entry){
+        .asset = asset, .texture = texture, .watch = watch,
+        .path = sf_str_dup(path), .name = sf_str_cdup(slash ? slash + 1 : path.c_str),
+    };
+    sf_mutex_lock(&reloader->lock);
+    if (reloader->count == reloader->capacity) {
+        reloader->capacity = reloader->capacity ? reloader->capacity * 2 : 16;
+        reloader->entries = realloc(reloader->entries, reloader->capacity * sizeof(sf_reload_entry *));
+    }
+    reloader->entries[reloader->count++] = entry;
+    sf_mutex_unlock(&reloader->lock);
+    return true;
+}
+
+bool sf_reloader_watch_shader(sf_reloader *reloader, sf_shader *shader) {
+    return sf_reloader_watch(reloader, shader, false, shader->path);
+}
+
+bool sf_reloader_watch_texture(sf_reloader *reloader, sf_texture *texture) {
+    return sf_reloader_watch(reloader, texture, true, texture->path);
+}
+
+void sf_reloader_forget(sf_reloader *reloader, const void *asset) {
+    if (reloader == NULL)
+        return;
+    sf_mutex_lock(&reloader->lock);
+    for (size_t i = 0; i < reloader->count; ++i) {
+        if (reloader->entries[i]->asset == asset) {
+            sf_reloader_remove(reloader, i);
+            break;
+        }
+    }
+    sf_mutex_unlock(&reloader->lock);
+}
+
+size_t sf_reloader_apply(sf_reloader *reloader) {
+    if (reloader == NULL)
+        return 0;
+    // The watcher only holds the lock to mark and fill entries, so this never waits on a read.
+    size_t swapped = 0;
+    sf_mutex_lock(&reloader->lock);
+    for (size_t i = 0; i < reloader->count; ++i) {
+        sf_reload_entry *entry = reloader->entries[i];
+        if (entry->texture) {
+            if (entry->result.pixels) {
+                sf_texture_set_pixels(entry->asset, entry->result.pixels, (sf_vec2){(float)entry->result.width, (float)entry->result.height});
+                sf_reload_result_free(&entry->result);
+                swapped++;
+            }
+            continue;
+        }
+
+        if (entry->compiling) {
+            const sf_ready_ex ready = sf_shader_ready(&entry->next);
+            if (!ready.is_ok) {
+                // The old program stays until the files are fixed.
+                fprintf(stderr, "%s\n", ready.value.err.compile_err.c_str);
+                sf_str_free(ready.value.err.compile_err);
+                sf_shader_free(&entry->next);
+                entry->compiling = false;
+            } else if (ready.value.ok) {
+                sf_shader_replace(entry->asset, &entry->next);
+                entry->compiling = false;
+                swapped++;
+            }
+        }
+        // A newer read waits for the program before it to be done.
+        if (!entry->compiling && entry->result.vertex) {
+            const sf_shader_ex next = sf_shader_from_memory_async(((sf_shader *)entry->asset)->path,
+                entry->result.vertex, entry->result.fragment);
+            sf_reload_result_free(&entry->result);
+            if (next.is_ok) {
+                entry->next = next.value.ok;
+                entry->compiling = true;
+            } else {
+                fprintf(stderr, "Can't reload shader '%s'\n", ((sf_shader *)entry->asset)->path.c_str);
+                if (next.value.err.compile_err.c_str)
+                    sf_str_free(next.value.err.compile_err);
+            }
+        }
+    }
+    sf_mutex_unlock(&reloader->lock);
+    return swapped;
+}
+
+#else
+
+sf_reloader *sf_reloader_new(void) {
+    return NULL;
+}
+
+void sf_reloader_free(sf_reloader *reloader) {
+    (void)reloader;
+}
+
+bool sf_reloader_watch_shader(sf_reloader *reloader, sf_shader *shader) {
+    (void)reloader, (void)shader;
+    return false;
+}
+
+bool sf_reloader_watch_texture(sf_reloader *reloader, sf_texture *texture) {
+    (void)reloader, (void)texture;
+    return false;
+}
+
+void sf_reloader_forget(sf_reloader *reloader, const void *asset) {
+    (void)reloader, (void)asset;
+}
+
+size_t sf_reloader_apply(sf_reloader *reloader) {
+    (void)reloader;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sf/math.h>
+#include "sf/gfx/shaders.h"
+
+/// "SFPB", at the start of every cached program binary.
+#define SF_SHADER_CACHE_MAGIC 0x42504653u
+
+/// What a cached program binary starts with.
+typedef struct {
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint64_t length;
+} sf_shader_cache_header;
+
+/// The cache directory, or empty if the cache is off.
+static sf_str sf_shader_cache;
+
+void sf_shader_cache_dir(const sf_str dir) {
+    if (sf_shader_cache.c_str != NULL)
+        sf_str_free(sf_shader_cache);
+    sf_shader_cache = dir.c_str != NULL && dir.len != 0 ? sf_str_dup(dir) : SF_STR_EMPTY;
+}
+
+/// Fold a null terminated string into a 64 bit fnv-1a hash, along with its length.
+static uint64_t sf_shader_cache_hash(uint64_t hash, const char *str) {
+    const size_t length = str ? strlen(str) : 0;
+    for (size_t i = 0; i < length; ++i)
+        hash = (hash ^ (uint8_t)str[i]) * 0x100000001b3ull;
+    for (size_t i = 0; i < sizeof(length); ++i)
+        hash = (hash ^ ((length >> (i * 8)) & 0xFF)) * 0x100000001b3ull;
+    return hash;
+}
+
+uint64_t sf_shader_cache_key(const char *vertex_source, const char *fragment_source) {
+    if (sf_shader_cache.c_str == NULL)
+        return SF_SHADER_CACHE_OFF;
+
+    // A binary is only valid for the driver that made it.
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = sf_shader_cache_hash(hash, vertex_source);
+    hash = sf_shader_cache_hash(hash, fragment_source);
+    hash = sf_shader_cache_hash(hash, (const char *)glGetString(GL_VENDOR));
+    hash = sf_shader_cache_hash(hash, (const char *)glGetString(GL_RENDERER));
+    hash = sf_shader_cache_hash(hash, (const char *)glGetString(GL_VERSION));
+    return hash == SF_SHADER_CACHE_OFF ? 1 : hash;
+}
+
+/// Get the file a key's binary is cached in.
+static sf_str sf_shader_cache_path(const uint64_t key) {
+    return sf_str_fmt("%s/%016" PRIx64 ".sfpb", sf_shader_cache.c_str, key);
+}
+
+GLuint sf_shader_cache_load(const uint64_t key) {
+    if (key == SF_SHADER_CACHE_OFF || sf_shader_cache.c_str == NULL)
+        return 0;
+
+    const sf_str path = sf_shader_cache_path(key);
+    FILE *file = fopen(path.c_str, "rb");
+    sf_str_free(path);
+    if (!file)
+        return 0;
+
+    sf_shader_cache_header header;
+    void *binary = NULL;
+    const bool read = fread(&header, sizeof(header), 1, file) == 1
+        && header.magic == SF_SHADER_CACHE_MAGIC && header.key == key
+        && header.length != 0 && header.length <= INT32_MAX
+        && (binary = malloc((size_t)header.length)) != NULL
+        && fread(binary, 1, (size_t)header.length, file) == header.length;
+    fclose(file);
+    if (!read) {
+        free(binary);
+        return 0;
+    }
+
+    // Drivers reject binaries after an update, which only means compiling from source again.
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+    free(binary);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        sf_gl_delete_program(program);
+        return 0;
+    }
+    return program;
+}
+
+bool sf_shader_cache_store(const uint64_t key, const GLuint program) {
+    GLint formats = 0, length = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (key == SF_SHADER_CACHE_OFF || sf_shader_cache.c_str == NULL || formats <= 0)
+        return false;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    void *binary = malloc((size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary);
+    if (written <= 0) {
+        free(binary);
+        return false;
+    }
+
+    const sf_shader_cache_header header = {SF_SHADER_CACHE_MAGIC, format, key, (uint64_t)written};
+    const sf_str path = sf_shader_cache_path(key);
+    FILE *file = fopen(path.c_str, "wb");
+    sf_str_free(path);
+    bool saved = false;
+    if (file) {
+        saved = fwrite(&header, sizeof(header), 1, file) == 1
+            && fwrite(binary, 1, (size_t)written, file) == (size_t)written;
+        saved = fclose(file) == 0 && saved;
+    }
+    free(binary);
+    return saved;
+}
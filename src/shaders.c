@@ -1,166 +1,554 @@
 #include <sf/math.h>
 #include <sf/fs.h>
+#include "sf/gfx/camera.h"
 #include "sf/gfx/shaders.h"
 #include "sf/str.h"
 
-#define EXPECTED_NAME ls_ex
-#define EXPECTED_O GLuint
-#define EXPECTED_E sf_shader_err
-#include <sf/containers/expected.h>
-
-ls_ex sf_load_shader(const GLenum type, const sf_str path) {
+/// Read and expand the source of a shader stage from the path with its extension.
+static sf_source_ex sf_read_shader(const GLenum type, const sf_str path, const char *defines) {
     const sf_str spath = sf_str_fmt("%s.%s", path.c_str, type == GL_FRAGMENT_SHADER ? "frag" : "vert");
-    uint8_t *sbuffer = NULL;
+    const sf_source_ex out = sf_shader_source(spath, defines);
+    sf_str_free(spath);
+    return out;
+}
+
+/// Read a linked program's active uniforms into its shader's table, and resolve the handles sepgfx uses.
+static void sf_shader_reflect(sf_shader *shader) {
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(shader->program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(shader->program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    char *name = malloc((size_t)max_length + 1);
+    shader->uniform_info = malloc((size_t)(count > 0 ? count : 1) * sizeof(sf_uniform_info));
+    shader->uniform_count = 0;
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        name[0] = '\0';
+        glGetActiveUniform(shader->program, (GLuint)i, max_length + 1, &length, &size, &type, name);
+        name[length] = '\0';
+
+        // Uniforms in blocks have no location, they're set through their buffer.
+        const GLint location = glGetUniformLocation(shader->program, name);
+        if (location < 0)
+            continue;
+        if (length > 3 && strcmp(name + length - 3, "[0]") == 0)
+            name[length - 3] = '\0';
+
+        const sf_uniform_id id = shader->uniform_count++;
+        shader->uniform_info[id] = (sf_uniform_info){sf_str_cdup(name), location, type, size, {0}, false, false};
+        sf_uniform_map_set(&shader->uniforms, shader->uniform_info[id].name, id);
+    }
+    free(name);
 
-    GLuint sh = glCreateShader(type);
+    shader->u_model = sf_shader_uniform_id(shader, sf_lit("m_model"));
+    shader->u_sampler = sf_shader_uniform_id(shader, sf_lit("t_sampler"));
+    shader->u_projection = sf_shader_uniform_id(shader, sf_lit("m_projection"));
+    shader->u_campos = sf_shader_uniform_id(shader, sf_lit("m_campos"));
+}
 
-    const long s = sf_file_size(spath);
-    if (s <= 0) {
-        sf_str_free(spath);
-        return ls_ex_err((sf_shader_err){SF_SHADER_NOT_FOUND, SF_STR_EMPTY});
+/// Read a linked program's active vertex inputs, and the locations they read.
+static void sf_shader_reflect_attribs(sf_shader *shader) {
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(shader->program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(shader->program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_length);
+
+    char *name = malloc((size_t)max_length + 1);
+    shader->attrib_info = malloc((size_t)(count > 0 ? count : 1) * sizeof(sf_attrib_info));
+    shader->attrib_count = 0;
+    shader->attrib_locations = 0;
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        name[0] = '\0';
+        glGetActiveAttrib(shader->program, (GLuint)i, max_length + 1, &length, &size, &type, name);
+        name[length] = '\0';
+
+        // Built-in inputs are active too, but have no location and aren't fed by a mesh.
+        const GLint location = glGetAttribLocation(shader->program, name);
+        if (location < 0)
+            continue;
+        shader->attrib_info[shader->attrib_count++] = (sf_attrib_info){sf_str_cdup(name), location, type, size};
+        const uint32_t locations = sf_attrib_columns(type) * (uint32_t)size;
+        for (uint32_t l = (uint32_t)location; l < (uint32_t)location + locations && l < 32; ++l)
+            shader->attrib_locations |= 1u << l;
     }
+    free(name);
+}
 
-    sbuffer = malloc((size_t)s + 1);
-    sf_fs_ex fres = sf_load_file(sbuffer, spath);
-    if (!fres.is_ok) {
-        sf_str_free(spath);
-        free(sbuffer);
-        glDeleteShader(sh);
-        return ls_ex_err((sf_shader_err){SF_SHADER_NOT_FOUND, SF_STR_EMPTY});
+#ifndef GL_COMPLETION_STATUS_KHR
+#    define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+/// Whether the driver can be asked if a program is done without waiting for it.
+static bool sf_parallel_compile = false;
+
+void sf_shader_parallel_init(const sf_max_threads_proc max_threads) {
+    sf_parallel_compile = false;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count && !sf_parallel_compile; ++i) {
+        const char *name = (const char *)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        sf_parallel_compile = name && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0
+            || strcmp(name, "GL_ARB_parallel_shader_compile") == 0);
     }
-    sbuffer[s] = '\0';
+    // The driver picks how many threads to use.
+    if (sf_parallel_compile && max_threads)
+        max_threads(0xFFFFFFFFu);
+}
 
-    glShaderSource(sh, 1, (const GLchar **)&sbuffer, NULL);
-    glCompileShader(sh);
+/// Start a program from the sources of its stages, or load it from the program cache if it was linked before.
+/// Nothing waits on the driver, the shader is pending until sf_shader_finish.
+static sf_shader sf_shader_start(const sf_str path, const char *vertex_source, const char *fragment_source) {
+    sf_shader out = {
+        .path = sf_str_dup(path),
+        .uniforms = sf_uniform_map_new(),
+        .u_model = SF_UNIFORM_NONE, .u_sampler = SF_UNIFORM_NONE,
+        .u_projection = SF_UNIFORM_NONE, .u_campos = SF_UNIFORM_NONE,
+        .pending = true,
+        .cache_key = sf_shader_cache_key(vertex_source, fragment_source),
+    };
+    out.program = sf_shader_cache_load(out.cache_key);
+    if (out.program != 0)
+        return out;
+
+    out.stages[0] = glCreateShader(GL_VERTEX_SHADER);
+    out.stages[1] = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(out.stages[0], 1, (const GLchar **)&vertex_source, NULL);
+    glShaderSource(out.stages[1], 1, (const GLchar **)&fragment_source, NULL);
+    glCompileShader(out.stages[0]);
+    glCompileShader(out.stages[1]);
+
+    out.program = glCreateProgram();
+    if (out.cache_key != SF_SHADER_CACHE_OFF)
+        glProgramParameteri(out.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(out.program, out.stages[0]);
+    glAttachShader(out.program, out.stages[1]);
+    glLinkProgram(out.program);
+    return out;
+}
 
-    int success;
-    glGetShaderiv(sh, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetShaderInfoLog(sh, 512, NULL, log);
+/// Wait for a pending shader to compile and link, then cache it and read its uniforms.
+/// On failure the shader is left pending, for its owner to free.
+static sf_ready_ex sf_shader_finish(sf_shader *shader) {
+    sf_str error = SF_STR_EMPTY;
+    for (int i = 0; i < 2 && shader->stages[i] != 0 && error.c_str == NULL; ++i) {
+        int success;
+        glGetShaderiv(shader->stages[i], GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char log[512];
+            glGetShaderInfoLog(shader->stages[i], 512, NULL, log);
+            error = sf_str_fmt("Failed to compile shader '%s': %s", shader->path.c_str, log);
+        }
+    }
+    if (error.c_str == NULL) {
+        int success;
+        glGetProgramiv(shader->program, GL_LINK_STATUS, &success);
+        if (!success) {
+            char log[512];
+            glGetProgramInfoLog(shader->program, 512, NULL, log);
+            error = sf_str_fmt("Failed to compile shader '%s': %s", shader->path.c_str, log);
+        }
+    }
+    if (error.c_str != NULL)
+        return sf_ready_ex_err((sf_shader_err){SF_SHADER_COMPILE_ERROR, error});
+
+    const bool compiled = shader->stages[0] != 0;
+    for (int i = 0; i < 2; ++i) {
+        if (shader->stages[i] != 0)
+            glDeleteShader(shader->stages[i]);
+        shader->stages[i] = 0;
+    }
+    if (compiled)
+        sf_shader_cache_store(shader->cache_key, shader->program);
+
+    // Glsl 410 can't pick a block's binding itself, so it's assigned once here.
+    const GLuint camera_block = glGetUniformBlockIndex(shader->program, "sf_camera");
+    shader->camera_block = camera_block != GL_INVALID_INDEX;
+    if (shader->camera_block)
+        glUniformBlockBinding(shader->program, camera_block, SF_CAMERA_BINDING);
+
+    static uint32_t link_ids = 0;
+    shader->link_id = ++link_ids;
+    sf_shader_reflect(shader);
+    sf_shader_reflect_attribs(shader);
+    shader->pending = false;
+    return sf_ready_ex_ok(true);
+}
 
-        sf_str_free(spath);
-        free(sbuffer);
-        glDeleteShader(sh);
-        return ls_ex_err((sf_shader_err){
-            SF_SHADER_COMPILE_ERROR,
-            sf_str_fmt("Failed to compile shader '%s': %s", path.c_str, log)
-        });
+/// Read both stages of a shader with a set of defines and start it.
+static sf_shader_ex sf_shader_read_start(const sf_str path, const char *defines) {
+    const sf_source_ex vertex = sf_read_shader(GL_VERTEX_SHADER, path, defines);
+    if (!vertex.is_ok)
+        return sf_shader_ex_err(vertex.value.err);
+    const sf_source_ex fragment = sf_read_shader(GL_FRAGMENT_SHADER, path, defines);
+    if (!fragment.is_ok) {
+        free(vertex.value.ok);
+        return sf_shader_ex_err(fragment.value.err);
     }
 
-    sf_str_free(spath);
-    free(sbuffer);
-    return ls_ex_ok(sh);
+    const sf_shader out = sf_shader_start(path, vertex.value.ok, fragment.value.ok);
+    free(vertex.value.ok);
+    free(fragment.value.ok);
+    return sf_shader_ex_ok(out);
 }
 
 sf_shader_ex sf_shader_new(const sf_str path) {
-    sf_shader out;
-    ls_ex res = sf_load_shader(GL_VERTEX_SHADER, path);
-    if (!res.is_ok)
-        return sf_shader_ex_err((sf_shader_err){res.value.err.type,  res.value.err.compile_err});
+    sf_shader_ex out = sf_shader_read_start(path, NULL);
+    if (!out.is_ok)
+        return out;
+    const sf_ready_ex ready = sf_shader_finish(&out.value.ok);
+    if (!ready.is_ok) {
+        sf_shader_free(&out.value.ok);
+        return sf_shader_ex_err(ready.value.err);
+    }
+    return out;
+}
 
-    GLuint vertex, fragment;
-    vertex = res.value.ok;
-    res = sf_load_shader(GL_FRAGMENT_SHADER, path);
-    if (!res.is_ok) {
-        glDeleteShader(vertex);
-        return sf_shader_ex_err((sf_shader_err){res.value.err.type,  res.value.err.compile_err});
+sf_shader_ex sf_shader_from_memory_async(const sf_str path, const char *vertex_source, const char *fragment_source) {
+    // Includes are relative to the shader's directory, like they'd be for its files.
+    const char *slash = strrchr(path.c_str, '/');
+    const sf_str dir = slash ? sf_str_fmt("%.*s", (int)(slash > path.c_str ? slash - path.c_str : 1), path.c_str) : sf_str_fmt("");
+    const sf_source_ex vertex = sf_shader_preprocess(vertex_source, dir, NULL);
+    const sf_source_ex fragment = sf_shader_preprocess(fragment_source, dir, NULL);
+    sf_str_free(dir);
+    if (!vertex.is_ok || !fragment.is_ok) {
+        if (vertex.is_ok)
+            free(vertex.value.ok);
+        else if (fragment.is_ok)
+            free(fragment.value.ok);
+        else sf_str_free(fragment.value.err.compile_err);
+        return sf_shader_ex_err(vertex.is_ok ? fragment.value.err : vertex.value.err);
     }
-    fragment = res.value.ok;
 
-    out.program = glCreateProgram();
-    glAttachShader(out.program, vertex);
-    glAttachShader(out.program, fragment);
-    glLinkProgram(out.program);
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    const sf_shader out = sf_shader_start(path, vertex.value.ok, fragment.value.ok);
+    free(vertex.value.ok);
+    free(fragment.value.ok);
+    return sf_shader_ex_ok(out);
+}
 
-    int success;
-    glGetProgramiv(out.program, GL_LINK_STATUS, &success);
-    if (!success) {
-        char log[512];
-        glGetProgramInfoLog(out.program, 512, NULL, log);
-        return sf_shader_ex_err((sf_shader_err){
-            SF_SHADER_COMPILE_ERROR,
-            sf_str_fmt("Failed to compile shader '%s': %s", path, log)
-        });
+sf_shader_ex sf_shader_from_memory(const sf_str path, const char *vertex_source, const char *fragment_source) {
+    sf_shader_ex out = sf_shader_from_memory_async(path, vertex_source, fragment_source);
+    if (!out.is_ok)
+        return out;
+    const sf_ready_ex ready = sf_shader_finish(&out.value.ok);
+    if (!ready.is_ok) {
+        sf_shader_free(&out.value.ok);
+        return sf_shader_ex_err(ready.value.err);
     }
+    return out;
+}
 
-    out.uniforms = sf_uniform_map_new();
-    out.path = sf_str_dup(path);
+sf_shader_ex sf_shader_new_async(const sf_str path) {
+    return sf_shader_read_start(path, NULL);
+}
 
-    return sf_shader_ex_ok(out);
+void sf_shader_new_batch(const sf_str *paths, const size_t count, sf_shader_ex *out) {
+    for (size_t i = 0; i < count; ++i)
+        out[i] = sf_shader_read_start(paths[i], NULL);
+}
+
+sf_ready_ex sf_shader_ready(sf_shader *shader) {
+    if (!shader->pending)
+        return sf_ready_ex_ok(true);
+    if (sf_parallel_compile) {
+        GLint done = GL_FALSE;
+        glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+            return sf_ready_ex_ok(false);
+    }
+    return sf_shader_finish(shader);
+}
+
+/// A shader's variants, each under its sorted and joined defines.
+struct sf_shader_variants {
+    sf_str *keys;
+    sf_shader **shaders;
+    size_t count;
+};
+
+static int sf_define_compare(const void *a, const void *b) {
+    return strcmp(((const sf_str *)a)->c_str, ((const sf_str *)b)->c_str);
+}
+
+sf_str sf_shader_variant_defines(const sf_str *defines, const size_t count) {
+    // The same defines in any order, or repeated, make the same text.
+    sf_str *sorted = malloc((count ? count : 1) * sizeof(sf_str));
+    if (count) {
+        memcpy(sorted, defines, count * sizeof(sf_str));
+        qsort(sorted, count, sizeof(sf_str), sf_define_compare);
+    }
+    sf_str key = sf_str_fmt("");
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0 && strcmp(sorted[i].c_str, sorted[i - 1].c_str) == 0)
+            continue;
+        const sf_str joined = sf_str_fmt("%s%s\n", key.c_str, sorted[i].c_str);
+        sf_str_free(key);
+        key = joined;
+    }
+    free(sorted);
+
+    // "NAME=VALUE" becomes "#define NAME VALUE".
+    sf_str text = sf_str_fmt("");
+    for (const char *line = key.c_str; *line;) {
+        const size_t length = (size_t)(strchr(line, '\n') - line);
+        const char *equals = memchr(line, '=', length);
+        const sf_str next = equals
+            ? sf_str_fmt("%s#define %.*s %.*s\n", text.c_str, (int)(equals - line), line, (int)(length - (size_t)(equals - line) - 1), equals + 1)
+            : sf_str_fmt("%s#define %.*s\n", text.c_str, (int)length, line);
+        sf_str_free(text);
+        text = next;
+        line += length + 1;
+    }
+    sf_str_free(key);
+    return text;
+}
+
+sf_variant_ex sf_shader_variant(sf_shader *shader, const sf_str *defines, const size_t count) {
+    // The define text doubles as the key, so equivalent sets find the same variant.
+    const sf_str key = sf_shader_variant_defines(defines, count);
+    struct sf_shader_variants *variants = shader->variants;
+    for (size_t i = 0; variants && i < variants->count; ++i) {
+        if (strcmp(variants->keys[i].c_str, key.c_str) == 0) {
+            sf_str_free(key);
+            return sf_variant_ex_ok(variants->shaders[i]);
+        }
+    }
+
+    sf_shader_ex compiled = sf_shader_read_start(shader->path, key.c_str);
+    if (compiled.is_ok) {
+        const sf_ready_ex ready = sf_shader_finish(&compiled.value.ok);
+        if (!ready.is_ok) {
+            sf_shader_free(&compiled.value.ok);
+            compiled = sf_shader_ex_err(ready.value.err);
+        }
+    }
+    if (!compiled.is_ok) {
+        sf_str_free(key);
+        return sf_variant_ex_err(compiled.value.err);
+    }
+
+    if (variants == NULL)
+        variants = shader->variants = calloc(1, sizeof(struct sf_shader_variants));
+    variants->keys = realloc(variants->keys, (variants->count + 1) * sizeof(sf_str));
+    variants->shaders = realloc(variants->shaders, (variants->count + 1) * sizeof(sf_shader *));
+    sf_shader *variant = malloc(sizeof(sf_shader));
+    *variant = compiled.value.ok;
+    variants->keys[variants->count] = key;
+    variants->shaders[variants->count] = variant;
+    variants->count++;
+    return sf_variant_ex_ok(variant);
 }
 
 void sf_shader_free(sf_shader *shader) {
+    for (int i = 0; i < 2; ++i) {
+        if (shader->stages[i] != 0)
+            glDeleteShader(shader->stages[i]);
+        shader->stages[i] = 0;
+    }
+    if (shader->variants) {
+        for (size_t i = 0; i < shader->variants->count; ++i) {
+            sf_str_free(shader->variants->keys[i]);
+            sf_shader_free(shader->variants->shaders[i]);
+            free(shader->variants->shaders[i]);
+        }
+        free(shader->variants->keys);
+        free(shader->variants->shaders);
+        free(shader->variants);
+        shader->variants = NULL;
+    }
     sf_str_free(shader->path);
-    glDeleteProgram(shader->program);
+    sf_gl_delete_program(shader->program);
+    for (uint32_t i = 0; i < shader->uniform_count; ++i)
+        sf_str_free(shader->uniform_info[i].name);
+    free(shader->uniform_info);
     sf_uniform_map_free(&shader->uniforms);
+    for (uint32_t i = 0; i < shader->attrib_count; ++i)
+        sf_str_free(shader->attrib_info[i].name);
+    free(shader->attrib_info);
 }
 
-#define EXPECTED_NAME gu_ex
-#define EXPECTED_O GLint
-#include <sf/containers/expected.h>
+void sf_shader_replace(sf_shader *shader, sf_shader *with) {
+    // Uniforms the old program had keep their handles, with no location if the new one dropped them.
+    // Values written to the old program are gone, so nothing is known about them.
+    const uint32_t capacity = shader->uniform_count + with->uniform_count;
+    sf_uniform_info *table = malloc((capacity ? capacity : 1) * sizeof(sf_uniform_info));
+    uint32_t count = shader->uniform_count;
+    for (uint32_t i = 0; i < count; ++i) {
+        const sf_uniform_info *old = shader->uniform_info + i;
+        table[i] = (sf_uniform_info){old->name, -1, old->type, 0, {0}, false, old->material};
+    }
+    for (uint32_t i = 0; i < with->uniform_count; ++i) {
+        const sf_uniform_info *info = with->uniform_info + i;
+        const sf_uniform_map_ex old = sf_uniform_map_get(&shader->uniforms, info->name);
+        if (old.is_ok) {
+            sf_uniform_info *kept = table + old.value.ok;
+            *kept = (sf_uniform_info){kept->name, info->location, info->type, info->size, {0}, false, kept->material};
+            sf_str_free(info->name);
+        } else table[count++] = *info;
+    }
+    // Array elements were looked up by name, and the new program may still have them.
+    for (uint32_t i = 0; i < shader->uniform_count; ++i)
+        if (table[i].location < 0 && strchr(table[i].name.c_str, '['))
+            table[i].location = glGetUniformLocation(with->program, table[i].name.c_str);
+
+    sf_uniform_map_free(&shader->uniforms);
+    shader->uniforms = sf_uniform_map_new();
+    for (uint32_t i = 0; i < count; ++i)
+        sf_uniform_map_set(&shader->uniforms, table[i].name, i);
+    free(shader->uniform_info);
+    free(with->uniform_info);
+    shader->uniform_info = table;
+    shader->uniform_count = count;
+
+    sf_gl_delete_program(shader->program);
+    shader->program = with->program;
+    shader->camera_block = with->camera_block;
+    shader->cache_key = with->cache_key;
+    shader->link_id = with->link_id;
+    shader->material = NULL;
+    shader->u_model = sf_shader_uniform_id(shader, sf_lit("m_model"));
+    shader->u_sampler = sf_shader_uniform_id(shader, sf_lit("t_sampler"));
+    shader->u_projection = sf_shader_uniform_id(shader, sf_lit("m_projection"));
+    shader->u_campos = sf_shader_uniform_id(shader, sf_lit("m_campos"));
+    for (uint32_t i = 0; i < shader->attrib_count; ++i)
+        sf_str_free(shader->attrib_info[i].name);
+    free(shader->attrib_info);
+    shader->attrib_info = with->attrib_info;
+    shader->attrib_count = with->attrib_count;
+    shader->attrib_locations = with->attrib_locations;
+    with->program = 0;
+    with->uniform_info = NULL;
+    with->uniform_count = 0;
+    with->attrib_info = NULL;
+    with->attrib_count = 0;
+    sf_shader_free(with);
+}
 
-gu_ex sf_get_uniform(sf_shader *shader, const sf_str name) {
-    sf_shader_bind(shader);
-    sf_uniform_map_ex res = sf_uniform_map_get(&shader->uniforms, name);
+sf_uniform_id sf_shader_uniform_id(sf_shader *shader, const sf_str name) {
+    const sf_uniform_map_ex res = sf_uniform_map_get(&shader->uniforms, name);
     if (res.is_ok)
-        return gu_ex_ok(res.value.ok);
+        return res.value.ok;
+    if (shader->program == 0 || shader->pending)
+        return SF_UNIFORM_NONE;
+
+    // The first element of an array is the array itself.
+    const char *bracket = strchr(name.c_str, '[');
+    if (bracket && strcmp(bracket, "[0]") == 0) {
+        const sf_str base = sf_str_fmt("%.*s", (int)(bracket - name.c_str), name.c_str);
+        const sf_uniform_map_ex first = sf_uniform_map_get(&shader->uniforms, base);
+        sf_str_free(base);
+        return first.is_ok ? first.value.ok : SF_UNIFORM_NONE;
+    }
 
-    const GLint loc = glGetUniformLocation(shader->program, name.c_str);
-    if (loc < 0)
-        return gu_ex_err();
-    sf_uniform_map_set(&shader->uniforms, name, loc);
+    // Other elements aren't reflected, so they're added the first time they're named.
+    const GLint location = glGetUniformLocation(shader->program, name.c_str);
+    if (location < 0)
+        return SF_UNIFORM_NONE;
+    GLenum type = 0;
+    if (bracket) {
+        const sf_str base = sf_str_fmt("%.*s", (int)(bracket - name.c_str), name.c_str);
+        const sf_uniform_map_ex array = sf_uniform_map_get(&shader->uniforms, base);
+        sf_str_free(base);
+        if (array.is_ok)
+            type = shader->uniform_info[array.value.ok].type;
+    }
+    shader->uniform_info = realloc(shader->uniform_info, (shader->uniform_count + 1) * sizeof(sf_uniform_info));
+    const sf_uniform_id id = shader->uniform_count++;
+    shader->uniform_info[id] = (sf_uniform_info){sf_str_dup(name), location, type, 1, {0}, false, false};
+    sf_uniform_map_set(&shader->uniforms, shader->uniform_info[id].name, id);
+    return id;
+}
 
-    return gu_ex_ok(loc);
+/// Check a uniform's new value against the last one written and remember it.
+/// Returns true if it has to be uploaded, with the uniform's shader bound.
+/// Uploading a uniform that a material sets means the shader no longer has that material applied.
+static bool sf_uniform_changes(sf_shader *shader, sf_uniform_info *info, const void *value, const size_t size) {
+    if (info->known && memcmp(info->value, value, size) == 0) {
+        sf_gl_current->counters.uniforms_skipped++;
+        return false;
+    }
+    memcpy(info->value, value, size);
+    info->known = true;
+    if (info->material)
+        shader->material = NULL;
+    sf_gl_current->counters.uniforms_issued++;
+    sf_shader_bind(shader);
+    return true;
 }
 
-sf_uniform_ex sf_shader_uniform_float(sf_shader *shader, const sf_str name, const float value) {
-    const gu_ex res = sf_get_uniform(shader, name);
-    if (!res.is_ok)
+sf_uniform_ex sf_shader_set_float(sf_shader *shader, const sf_uniform_id id, const float value) {
+    if (id >= shader->uniform_count)
         return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
-    glUniform1f(res.value.ok, value);
+    sf_uniform_info *info = shader->uniform_info + id;
+    if (sf_uniform_changes(shader, info, &value, sizeof(value)))
+        glUniform1f(info->location, value);
 
     return sf_uniform_ex_ok();
 }
 
-sf_uniform_ex sf_shader_uniform_int(sf_shader *shader, const sf_str name, const int value) {
-    const gu_ex res = sf_get_uniform(shader, name);
-    if (!res.is_ok)
+sf_uniform_ex sf_shader_set_int(sf_shader *shader, const sf_uniform_id id, const int value) {
+    if (id >= shader->uniform_count)
         return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
-    glUniform1i(res.value.ok, value);
+    sf_uniform_info *info = shader->uniform_info + id;
+    if (sf_uniform_changes(shader, info, &value, sizeof(value)))
+        glUniform1i(info->location, value);
 
     return sf_uniform_ex_ok();
 }
 
-sf_uniform_ex sf_shader_uniform_vec2(sf_shader *shader, const sf_str name, const sf_vec2 value) {
-    const gu_ex res = sf_get_uniform(shader, name);
-    if (!res.is_ok)
+sf_uniform_ex sf_shader_set_vec2(sf_shader *shader, const sf_uniform_id id, const sf_vec2 value) {
+    if (id >= shader->uniform_count)
         return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
-    glUniform2f(res.value.ok, value.x, value.y);
+    sf_uniform_info *info = shader->uniform_info + id;
+    if (sf_uniform_changes(shader, info, &value, sizeof(value)))
+        glUniform2f(info->location, value.x, value.y);
 
     return sf_uniform_ex_ok();
 }
 
-sf_uniform_ex sf_shader_uniform_vec3(sf_shader *shader, const sf_str name, const sf_vec3 value) {
-    const gu_ex res = sf_get_uniform(shader, name);
-    if (!res.is_ok)
+sf_uniform_ex sf_shader_set_vec3(sf_shader *shader, const sf_uniform_id id, const sf_vec3 value) {
+    if (id >= shader->uniform_count)
         return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
-    glUniform3f(res.value.ok, value.x, value.y, value.z);
+    sf_uniform_info *info = shader->uniform_info + id;
+    if (sf_uniform_changes(shader, info, &value, sizeof(value)))
+        glUniform3f(info->location, value.x, value.y, value.z);
 
     return sf_uniform_ex_ok();
 }
 
-sf_uniform_ex sf_shader_uniform_mat4(sf_shader *shader, const sf_str name, const mat4 value) {
-    const gu_ex res = sf_get_uniform(shader, name);
-    if (!res.is_ok)
+sf_uniform_ex sf_shader_set_mat4(sf_shader *shader, const sf_uniform_id id, const mat4 value) {
+    if (id >= shader->uniform_count)
         return sf_uniform_ex_err((sf_shader_err){SF_SHADER_UNKNOWN_UNIFORM, SF_STR_EMPTY});
-    glUniformMatrix4fv(res.value.ok, 1, false, (const GLfloat *)value);
+    sf_uniform_info *info = shader->uniform_info + id;
+    if (sf_uniform_changes(shader, info, value, sizeof(mat4)))
+        glUniformMatrix4fv(info->location, 1, false, (const GLfloat *)value);
 
     return sf_uniform_ex_ok();
 }
 
+sf_uniform_ex sf_shader_uniform_float(sf_shader *shader, const sf_str name, const float value) {
+    return sf_shader_set_float(shader, sf_shader_uniform_id(shader, name), value);
+}
+
+sf_uniform_ex sf_shader_uniform_int(sf_shader *shader, const sf_str name, const int value) {
+    return sf_shader_set_int(shader, sf_shader_uniform_id(shader, name), value);
+}
+
+sf_uniform_ex sf_shader_uniform_vec2(sf_shader *shader, const sf_str name, const sf_vec2 value) {
+    return sf_shader_set_vec2(shader, sf_shader_uniform_id(shader, name), value);
+}
+
+sf_uniform_ex sf_shader_uniform_vec3(sf_shader *shader, const sf_str name, const sf_vec3 value) {
+    return sf_shader_set_vec3(shader, sf_shader_uniform_id(shader, name), value);
+}
+
+sf_uniform_ex sf_shader_uniform_mat4(sf_shader *shader, const sf_str name, const mat4 value) {
+    return sf_shader_set_mat4(shader, sf_shader_uniform_id(shader, name), value);
+}
+
 void sf_transform_model(mat4 out, const sf_transform transform) {
     mat4 local;
     glm_mat4_identity(local);
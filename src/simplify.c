@@ -0,0 +1,289 @@
+#include <math.h>
+#include <stdlib.h>
+#include "sf/gfx/meshes.h"
+
+/// A symmetric 4x4 error quadric, summed from the planes around a vertex, and the total weight of the planes.
+typedef struct {
+    float a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+    float w;
+} sf_quadric;
+
+static void sf_quadric_add(sf_quadric *q, const sf_quadric *r) {
+    q->a2 += r->a2; q->b2 += r->b2; q->c2 += r->c2;
+    q->ab += r->ab; q->ac += r->ac; q->bc += r->bc;
+    q->ad += r->ad; q->bd += r->bd; q->cd += r->cd;
+    q->d2 += r->d2;
+    q->w += r->w;
+}
+
+/// Squared distance of a point from the planes in a quadric, averaged by their weights.
+static float sf_quadric_error(const sf_quadric *q, const sf_vec3 p) {
+    const float e = q->a2 * p.x * p.x + q->b2 * p.y * p.y + q->c2 * p.z * p.z
+        + 2.0f * (q->ab * p.x * p.y + q->ac * p.x * p.z + q->bc * p.y * p.z)
+        + 2.0f * (q->ad * p.x + q->bd * p.y + q->cd * p.z) + q->d2;
+    return e > 0 && q->w > 0 ? e / q->w : 0;
+}
+
+static sf_vec3 sf_vec3_sub(const sf_vec3 a, const sf_vec3 b) { return (sf_vec3){a.x - b.x, a.y - b.y, a.z - b.z}; }
+static sf_vec3 sf_vec3_cross(const sf_vec3 a, const sf_vec3 b) {
+    return (sf_vec3){a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+static float sf_vec3_dot(const sf_vec3 a, const sf_vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+typedef struct {
+    uint32_t from, to;
+    float error;
+} sf_collapse;
+
+static int sf_collapse_compare(const void *a, const void *b) {
+    const float x = ((const sf_collapse *)a)->error, y = ((const sf_collapse *)b)->error;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+/// Build lists of the triangles around every vertex. offsets must have room for vertex_count + 1.
+static void sf_simplify_adjacency(uint32_t *offsets, uint32_t *adjacency, const uint32_t *indices, const size_t index_count, const size_t vertex_count) {
+    memset(offsets, 0, (vertex_count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < index_count; ++i)
+        offsets[indices[i] + 1]++;
+    for (size_t v = 0; v < vertex_count; ++v)
+        offsets[v + 1] += offsets[v];
+    for (size_t i = 0; i < index_count; ++i)
+        adjacency[offsets[indices[i]]++] = (uint32_t)(i / 3);
+    // Filling moved every offset to the start of the next list; shift them back.
+    for (size_t v = vertex_count; v > 0; --v)
+        offsets[v] = offsets[v - 1];
+    offsets[0] = 0;
+}
+
+size_t sf_index_simplify(uint32_t *out, const uint32_t *indices, const size_t index_count, const sf_vec3 *positions,
+                         const size_t vertex_count, const size_t target_count, float *error) {
+    const size_t tri_count = index_count / 3;
+    memcpy(out, indices, tri_count * 3 * sizeof(uint32_t));
+    *error = 0;
+    if (tri_count == 0 || vertex_count == 0)
+        return tri_count * 3;
+
+    // Errors are measured in a unit cube, and scaled back to model units at the end.
+    sf_vec3 min = positions[0], max = positions[0];
+    for (size_t v = 1; v < vertex_count; ++v) {
+        min = (sf_vec3){fminf(min.x, positions[v].x), fminf(min.y, positions[v].y), fminf(min.z, positions[v].z)};
+        max = (sf_vec3){fmaxf(max.x, positions[v].x), fmaxf(max.y, positions[v].y), fmaxf(max.z, positions[v].z)};
+    }
+    float extent = fmaxf(max.x - min.x, fmaxf(max.y - min.y, max.z - min.z));
+    if (extent <= 0)
+        extent = 1;
+
+    sf_vec3 *p = malloc(vertex_count * sizeof(sf_vec3));
+    for (size_t v = 0; v < vertex_count; ++v)
+        p[v] = (sf_vec3){(positions[v].x - min.x) / extent, (positions[v].y - min.y) / extent, (positions[v].z - min.z) / extent};
+
+    // Vertices that share a position (uv or color seams) are welded to find the real topology.
+    uint32_t *weld = malloc(vertex_count * sizeof(uint32_t));
+    uint32_t *wedges = calloc(vertex_count, sizeof(uint32_t));
+    sf_vertex_table positions_table = sf_vertex_table_new();
+    sf_vertex_table_reserve(&positions_table, vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v) {
+        weld[v] = sf_vertex_table_intern(&positions_table, positions, sizeof(sf_vec3), positions + v,
+            sf_vertex_hash(positions + v, sizeof(sf_vec3)), (uint32_t)v);
+        wedges[weld[v]]++;
+    }
+    sf_vertex_table_free(&positions_table);
+
+    uint32_t *welded = malloc(tri_count * 3 * sizeof(uint32_t));
+    for (size_t i = 0; i < tri_count * 3; ++i)
+        welded[i] = weld[indices[i]];
+
+    uint32_t *offsets = malloc((vertex_count + 1) * sizeof(uint32_t));
+    uint32_t *adjacency = malloc(tri_count * 3 * sizeof(uint32_t));
+    sf_simplify_adjacency(offsets, adjacency, welded, tri_count * 3, vertex_count);
+
+    // Seams and open borders are locked in place, so the silhouette and texture mapping survive.
+    bool *border = calloc(vertex_count, sizeof(bool));
+    for (size_t t = 0; t < tri_count; ++t) {
+        for (size_t k = 0; k < 3; ++k) {
+            const uint32_t a = welded[t * 3 + k], b = welded[t * 3 + (k + 1) % 3];
+            uint32_t shared = 0;
+            for (uint32_t j = offsets[a]; j < offsets[a + 1]; ++j) {
+                const uint32_t *tri = welded + adjacency[j] * 3;
+                shared += tri[0] == b || tri[1] == b || tri[2] == b;
+            }
+            if (shared == 1)
+                border[a] = border[b] = true;
+        }
+    }
+    bool *locked = malloc(vertex_count * sizeof(bool));
+    for (size_t v = 0; v < vertex_count; ++v)
+        locked[v] = wedges[weld[v]] > 1 || border[weld[v]];
+    free(border);
+    free(welded);
+    free(wedges);
+    free(weld);
+
+    // Every vertex starts with the area weighted planes of its triangles.
+    sf_quadric *quadrics = calloc(vertex_count, sizeof(sf_quadric));
+    for (size_t t = 0; t < tri_count; ++t) {
+        const sf_vec3 a = p[indices[t * 3]], b = p[indices[t * 3 + 1]], c = p[indices[t * 3 + 2]];
+        sf_vec3 n = sf_vec3_cross(sf_vec3_sub(b, a), sf_vec3_sub(c, a));
+        const float length = sqrtf(sf_vec3_dot(n, n));
+        if (length <= 0)
+            continue;
+        n = (sf_vec3){n.x / length, n.y / length, n.z / length};
+        const float d = -sf_vec3_dot(n, a), w = length * 0.5f;
+        const sf_quadric q = {
+            w * n.x * n.x, w * n.y * n.y, w * n.z * n.z,
+            w * n.x * n.y, w * n.x * n.z, w * n.y * n.z,
+            w * n.x * d, w * n.y * d, w * n.z * d, w * d * d,
+            w,
+        };
+        for (size_t k = 0; k < 3; ++k)
+            sf_quadric_add(quadrics + indices[t * 3 + k], &q);
+    }
+
+    uint32_t *remap = malloc(vertex_count * sizeof(uint32_t));
+    bool *touched = malloc(vertex_count * sizeof(bool));
+    sf_collapse *collapses = malloc(tri_count * 6 * sizeof(sf_collapse));
+    size_t count = tri_count * 3;
+    float max_error = 0;
+
+    // Collapses are done in passes: the cheapest edges are collapsed first, and each vertex changes at most
+    // once per pass so the error and flip checks stay exact. Vertices only ever collapse onto other vertices,
+    // so every level can share the original vertex buffer.
+    while (count > target_count) {
+        sf_simplify_adjacency(offsets, adjacency, out, count, vertex_count);
+
+        size_t collapse_count = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t u = out[i], v = out[i - i % 3 + (i + 1) % 3];
+            if (!locked[u]) {
+                sf_quadric q = quadrics[u];
+                sf_quadric_add(&q, quadrics + v);
+                collapses[collapse_count++] = (sf_collapse){u, v, sf_quadric_error(&q, p[v])};
+            }
+            if (!locked[v]) {
+                sf_quadric q = quadrics[v];
+                sf_quadric_add(&q, quadrics + u);
+                collapses[collapse_count++] = (sf_collapse){v, u, sf_quadric_error(&q, p[u])};
+            }
+        }
+        if (collapse_count == 0)
+            break;
+        qsort(collapses, collapse_count, sizeof(sf_collapse), sf_collapse_compare);
+
+        for (size_t v = 0; v < vertex_count; ++v) {
+            remap[v] = (uint32_t)v;
+            touched[v] = false;
+        }
+
+        // Every collapse removes about two triangles.
+        const size_t goal = (count - target_count) / 6 + 1;
+        size_t done = 0;
+        for (size_t c = 0; c < collapse_count && done < goal; ++c) {
+            const uint32_t u = collapses[c].from, v = collapses[c].to;
+            if (touched[u] || touched[v])
+                continue;
+
+            // Reject collapses that would flip a triangle around u over.
+            bool flips = false;
+            for (uint32_t j = offsets[u]; j < offsets[u + 1] && !flips; ++j) {
+                const uint32_t *tri = out + adjacency[j] * 3;
+                if (tri[0] == v || tri[1] == v || tri[2] == v)
+                    continue;
+                const size_t k = tri[0] == u ? 0 : tri[1] == u ? 1 : 2;
+                const sf_vec3 b = p[tri[(k + 1) % 3]], d = p[tri[(k + 2) % 3]];
+                const sf_vec3 before = sf_vec3_cross(sf_vec3_sub(b, p[u]), sf_vec3_sub(d, p[u]));
+                const sf_vec3 after = sf_vec3_cross(sf_vec3_sub(b, p[v]), sf_vec3_sub(d, p[v]));
+                flips = sf_vec3_dot(before, after) <= 0;
+            }
+            if (flips)
+                continue;
+
+            remap[u] = v;
+            sf_quadric_add(quadrics + v, quadrics + u);
+            if (collapses[c].error > max_error)
+                max_error = collapses[c].error;
+            // Everything around u changes shape, so none of it may move again this pass.
+            for (uint32_t j = offsets[u]; j < offsets[u + 1]; ++j) {
+                const uint32_t *tri = out + adjacency[j] * 3;
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+            }
+            done++;
+        }
+        if (done == 0)
+            break;
+
+        // Rewrite the triangles and drop the ones that collapsed to a line.
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i += 3) {
+            const uint32_t a = remap[out[i]], b = remap[out[i + 1]], c = remap[out[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            out[kept++] = a;
+            out[kept++] = b;
+            out[kept++] = c;
+        }
+        count = kept;
+    }
+
+    free(collapses);
+    free(touched);
+    free(remap);
+    free(quadrics);
+    free(locked);
+    free(adjacency);
+    free(offsets);
+    free(p);
+
+    *error = sqrtf(max_error) * extent;
+    return count;
+}
+
+size_t sf_mesh_generate_lods(sf_mesh *mesh, const uint8_t levels, const float ratio) {
+    if (mesh->flags & SF_MESH_FROZEN)
+        return mesh->lod_count;
+    sf_mesh_own(mesh);
+    sf_mesh_lod_clear(mesh);
+    const size_t base_count = mesh->indices.count - mesh->indices.count % 3;
+    if (base_count == 0 || levels == 0)
+        return 0;
+
+    const size_t vertex_count = mesh->vertices.count;
+    sf_vec3 *positions = malloc(vertex_count * sizeof(sf_vec3));
+    sf_vertex_positions(&mesh->layout, mesh->vertices.data, vertex_count, positions);
+
+    uint32_t *previous = malloc(base_count * sizeof(uint32_t));
+    uint32_t *simplified = malloc(base_count * sizeof(uint32_t));
+    for (size_t i = 0; i < base_count; ++i)
+        previous[i] = sf_index_data_get(&mesh->indices, i);
+    mesh->lods[0] = (sf_mesh_lod){0, mesh->indices.count, 0};
+    mesh->lod_count = 1;
+
+    // Every level simplifies the one before it, so its error is bounded by the sum of the errors before it.
+    size_t count = base_count;
+    float error = 0;
+    while (mesh->lod_count < levels && mesh->lod_count < SF_MESH_MAX_LODS) {
+        const size_t target = (size_t)((float)count * ratio) / 3 * 3;
+        float level_error;
+        const size_t next = sf_index_simplify(simplified, previous, count, positions, vertex_count, target, &level_error);
+        // Stop once the simplifier is stuck on locked vertices.
+        if (next == 0 || (float)next > (float)count * 0.95f)
+            break;
+
+        error += level_error;
+        sf_index_optimize_cache(simplified, next, vertex_count);
+        const size_t offset = mesh->indices.count;
+        sf_index_data_reserve(&mesh->indices, offset + next);
+        for (size_t i = 0; i < next; ++i)
+            sf_index_data_push(&mesh->indices, simplified[i]);
+        mesh->lods[mesh->lod_count++] = (sf_mesh_lod){offset, next, error};
+
+        memcpy(previous, simplified, next * sizeof(uint32_t));
+        count = next;
+    }
+    if (mesh->lod_count > 1)
+        sf_mesh_range_mark(&mesh->dirty_indices, mesh->lods[1].offset, mesh->indices.count);
+
+    free(simplified);
+    free(previous);
+    free(positions);
+    return mesh->lod_count;
+}
@@ -0,0 +1,71 @@
+#include "sf/gfx/state.h"
+
+/// Used until a window makes its own cache current.
+static sf_gl_state sf_gl_default = SF_GL_STATE_UNKNOWN;
+sf_gl_state *sf_gl_current = &sf_gl_default;
+
+void sf_gl_state_invalidate(sf_gl_state *state) {
+    const sf_gl_counters counters = state->counters;
+    const sf_draw_stats draws = state->draws;
+    struct sf_camera_blocks *camera_blocks = state->camera_blocks;
+    *state = (sf_gl_state)SF_GL_STATE_UNKNOWN;
+    state->counters = counters;
+    state->draws = draws;
+    state->camera_blocks = camera_blocks;
+}
+
+void sf_gl_state_use(sf_gl_state *state) {
+    if (state == NULL) {
+        sf_gl_state_invalidate(&sf_gl_default);
+        state = &sf_gl_default;
+    }
+    sf_gl_current = state;
+}
+
+/// Forget a cached binding if it is one of the deleted names. Deleting unbinds them in the current context.
+static void sf_gl_forget(GLuint *cached, const GLsizei n, const GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) {
+        if (names[i] != 0 && *cached == names[i])
+            *cached = 0;
+    }
+}
+
+void sf_gl_delete_buffers(const GLsizei n, const GLuint *buffers) {
+    sf_gl_forget(&sf_gl_current->array_buffer, n, buffers);
+    sf_gl_forget(&sf_gl_current->element_buffer, n, buffers);
+    sf_gl_forget(&sf_gl_current->copy_read_buffer, n, buffers);
+    sf_gl_forget(&sf_gl_current->copy_write_buffer, n, buffers);
+    for (GLuint i = 0; i < SF_GL_UNIFORM_BINDINGS; ++i)
+        sf_gl_forget(&sf_gl_current->uniform_ranges[i].buffer, n, buffers);
+    glDeleteBuffers(n, buffers);
+}
+
+void sf_gl_delete_vaos(const GLsizei n, const GLuint *vaos) {
+    for (GLsizei i = 0; i < n; ++i) {
+        // Vao 0 is bound in its place, and its element buffer isn't known.
+        if (vaos[i] != 0 && sf_gl_current->vao == vaos[i]) {
+            sf_gl_current->vao = 0;
+            sf_gl_current->element_buffer = SF_GL_UNKNOWN;
+        }
+    }
+    glDeleteVertexArrays(n, vaos);
+}
+
+void sf_gl_delete_textures(const GLsizei n, const GLuint *textures) {
+    for (GLuint unit = 0; unit < SF_GL_TEXTURE_UNITS; ++unit)
+        sf_gl_forget(sf_gl_current->textures + unit, n, textures);
+    glDeleteTextures(n, textures);
+}
+
+void sf_gl_delete_framebuffers(const GLsizei n, const GLuint *framebuffers) {
+    sf_gl_forget(&sf_gl_current->framebuffer, n, framebuffers);
+    glDeleteFramebuffers(n, framebuffers);
+}
+
+void sf_gl_delete_program(const GLuint program) {
+    // A program in use is only deleted once it stops being used, so its name can't be reused until then.
+    // Forgetting it makes sure the next program is really bound.
+    if (program != 0 && sf_gl_current->program == program)
+        sf_gl_current->program = SF_GL_UNKNOWN;
+    glDeleteProgram(program);
+}
@@ -1,4 +1,5 @@
 #include <sf/fs.h>
+#include "sf/gfx/state.h"
 #include "sf/gfx/textures.h"
 #include "stb/stb_image.h"
 
@@ -8,7 +9,7 @@ sf_texture sf_texture_new(sf_texture_type type, const sf_vec2 dimensions) {
     };
 
     glGenTextures(1, &tex.handle);
-    glBindTexture(GL_TEXTURE_2D, tex.handle);
+    sf_gl_bind_texture(0, tex.handle);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -28,28 +29,34 @@ sf_texture_ex sf_texture_load(const sf_str path) {
     uint8_t *buffer = stbi_load(path.c_str, &width, &height, &channels, 4 /* RGBA */);
     if (!buffer)
         return sf_texture_ex_err(SF_READ_FAILURE);
-    out.dimensions = (sf_vec2){(float)width, (float)height};
 
     glGenTextures(1, &out.handle);
-    glBindTexture(GL_TEXTURE_2D, out.handle);
+    sf_gl_bind_texture(0, out.handle);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (int)out.dimensions.x,
-    (int)out.dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    sf_texture_set_pixels(&out, buffer, (sf_vec2){(float)width, (float)height});
+    stbi_image_free(buffer);
+    out.path = sf_str_dup(path);
 
     return sf_texture_ex_ok(out);
 }
 
+void sf_texture_set_pixels(sf_texture *texture, const uint8_t *pixels, const sf_vec2 dimensions) {
+    sf_gl_bind_texture(0, texture->handle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (int)dimensions.x,
+    (int)dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    sf_gl_bind_texture(0, 0);
+    texture->dimensions = dimensions;
+}
+
 EXPORT void sf_texture_resize(sf_texture *texture, const sf_vec2 dimensions) {
     if (dimensions.x == texture->dimensions.x && dimensions.y == texture->dimensions.y)
         return;
 
-    glBindTexture(GL_TEXTURE_2D, texture->handle);
+    sf_gl_bind_texture(0, texture->handle);
     GLint internal_format = GL_RGBA8;
     GLuint format = GL_RGBA;
     GLuint g_type = GL_UNSIGNED_BYTE;
@@ -72,11 +79,14 @@ EXPORT void sf_texture_resize(sf_texture *texture, const sf_vec2 dimensions) {
     if (texture->type != SF_TEXTURE_DEPTH_STENCIL) {
         glGenerateMipmap(GL_TEXTURE_2D);
     }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    sf_gl_bind_texture(0, 0);
     texture->dimensions = dimensions;
 }
 
 void sf_texture_delete(sf_texture *texture) {
-    glDeleteTextures(1, &texture->handle);
+    sf_gl_delete_textures(1, &texture->handle);
     texture->dimensions = (sf_vec2){0, 0};
+    if (texture->path.c_str != NULL)
+        sf_str_free(texture->path);
+    texture->path = (sf_str){0};
 }
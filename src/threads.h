@@ -0,0 +1,99 @@
+#ifndef SF_THREADS_H
+#define SF_THREADS_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include <windows.h>
+#else
+#    include <pthread.h>
+#endif
+
+/// A minimal native thread, only used internally.
+/// The struct must stay alive until it is joined.
+typedef struct {
+    void (*fn)(void *arg);
+    void *arg;
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+} sf_thread;
+
+#ifdef _WIN32
+static DWORD WINAPI sf_thread_main(LPVOID thread) {
+    ((sf_thread *)thread)->fn(((sf_thread *)thread)->arg);
+    return 0;
+}
+#else
+static void *sf_thread_main(void *thread) {
+    ((sf_thread *)thread)->fn(((sf_thread *)thread)->arg);
+    return NULL;
+}
+#endif
+
+/// Start running fn(arg) on a new thread.
+static inline bool sf_thread_start(sf_thread *thread, void (*fn)(void *arg), void *arg) {
+    thread->fn = fn;
+    thread->arg = arg;
+#ifdef _WIN32
+    return (thread->handle = CreateThread(NULL, 0, sf_thread_main, thread, 0, NULL)) != NULL;
+#else
+    return pthread_create(&thread->handle, NULL, sf_thread_main, thread) == 0;
+#endif
+}
+
+/// Wait for a thread to finish.
+static inline void sf_thread_join(sf_thread *thread) {
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+}
+
+/// A minimal native mutex, only used internally.
+typedef struct {
+#ifdef _WIN32
+    CRITICAL_SECTION handle;
+#else
+    pthread_mutex_t handle;
+#endif
+} sf_mutex;
+
+#ifdef _WIN32
+static inline void sf_mutex_init(sf_mutex *mutex)   { InitializeCriticalSection(&mutex->handle); }
+static inline void sf_mutex_free(sf_mutex *mutex)   { DeleteCriticalSection(&mutex->handle);     }
+static inline void sf_mutex_lock(sf_mutex *mutex)   { EnterCriticalSection(&mutex->handle);      }
+static inline void sf_mutex_unlock(sf_mutex *mutex) { LeaveCriticalSection(&mutex->handle);      }
+#else
+static inline void sf_mutex_init(sf_mutex *mutex)   { pthread_mutex_init(&mutex->handle, NULL); }
+static inline void sf_mutex_free(sf_mutex *mutex)   { pthread_mutex_destroy(&mutex->handle);    }
+static inline void sf_mutex_lock(sf_mutex *mutex)   { pthread_mutex_lock(&mutex->handle);       }
+static inline void sf_mutex_unlock(sf_mutex *mutex) { pthread_mutex_unlock(&mutex->handle);     }
+#endif
+
+/// Run fn(args + i * stride) for every i < count, each on its own thread.
+/// Work items whose thread fails to start are run on the calling thread instead.
+static inline void sf_thread_run(void (*fn)(void *arg), void *args, const size_t stride, const size_t count) {
+    if (count == 1) {
+        fn(args);
+        return;
+    }
+    sf_thread *threads = malloc(count * sizeof(sf_thread));
+    bool *started = malloc(count * sizeof(bool));
+    for (size_t i = 0; i < count; ++i)
+        started[i] = sf_thread_start(threads + i, fn, (char *)args + i * stride);
+    for (size_t i = 0; i < count; ++i) {
+        if (started[i]) sf_thread_join(threads + i);
+        else fn((char *)args + i * stride);
+    }
+    free(started);
+    free(threads);
+}
+
+#endif // SF_THREADS_H
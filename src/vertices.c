@@ -0,0 +1,569 @@
+#include <string.h>
+#include "sf/gfx/vertices.h"
+#include "threads.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SF_VERTEX_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#    include <arm_neon.h>
+#    define SF_VERTEX_NEON
+#endif
+
+/// The table is grown once it would be more than half full.
+#define SF_VERTEX_TABLE_LOAD(capacity) ((capacity) / 2)
+#define SF_VERTEX_TABLE_MIN 64
+
+static inline uint64_t sf_rotl64(const uint64_t x, const int r) { return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t sf_vertex_mix(uint64_t k) {
+    k *= 0x87c37b91114253d5ull;
+    k = sf_rotl64(k, 31);
+    return k * 0x4cf5ad432745937full;
+}
+
+uint64_t sf_vertex_hash(const void *vertex, const size_t size) {
+    const uint8_t *bytes = vertex;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t k;
+        memcpy(&k, bytes + i, 8);
+        h ^= sf_vertex_mix(k);
+        h = sf_rotl64(h, 27) * 5 + 0x52dce729;
+    }
+    if (i < size) {
+        uint64_t k = 0;
+        memcpy(&k, bytes + i, size - i);
+        h ^= sf_vertex_mix(k);
+    }
+
+    // Murmur3 finalizer, so the low bits used for bucketing are well mixed.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+bool sf_vertex_eq(const void *v1, const void *v2, const size_t size) {
+    const uint8_t *a = v1, *b = v2;
+    size_t i = 0;
+#if defined(SF_VERTEX_SSE2)
+    for (; i + 16 <= size; i += 16) {
+        const __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        if (_mm_movemask_epi8(eq) != 0xFFFF)
+            return false;
+    }
+#elif defined(SF_VERTEX_NEON)
+    for (; i + 16 <= size; i += 16) {
+        if (vminvq_u8(vceqq_u8(vld1q_u8(a + i), vld1q_u8(b + i))) != 0xFF)
+            return false;
+    }
+#endif
+    return memcmp(a + i, b + i, size - i) == 0;
+}
+
+/// Round to the nearest integer, halfway cases away from zero, ready to be truncated by a cast.
+/// Every path that encodes to integers rounds this way, so a vertex has the same bytes in any build or layout.
+static inline float sf_round(const float v) { return v < 0 ? v - 0.5f : v + 0.5f; }
+/// sf_round for 32 bit integers, in double so the largest values still fit, clamped to [lo, hi] first.
+static inline double sf_round_clamped(const double v, const double lo, const double hi) {
+    const double c = v < lo ? lo : v > hi ? hi : v;
+    return c < 0 ? c - 0.5 : c + 0.5;
+}
+
+/// Convert a float color to normalized rgba8, saturating out of range channels.
+static inline void sf_encode_rgba8(const sf_glcolor color, uint8_t out[4]) {
+#if defined(SF_VERTEX_SSE2)
+    // Negative channels saturate to 0 when packed, so only the positive half of sf_round is needed.
+    const __m128 scaled = _mm_mul_ps(_mm_loadu_ps(color.gl), _mm_set1_ps(255.0f));
+    __m128i c = _mm_cvttps_epi32(_mm_add_ps(scaled, _mm_set1_ps(0.5f)));
+    c = _mm_packs_epi32(c, c);
+    c = _mm_packus_epi16(c, c);
+    const int packed = _mm_cvtsi128_si32(c);
+    memcpy(out, &packed, 4);
+#else
+    for (int i = 0; i < 4; ++i) {
+        const float v = color.gl[i] < 0 ? 0 : color.gl[i] > 1 ? 1 : color.gl[i];
+        out[i] = (uint8_t)sf_round(v * 255.0f);
+    }
+#endif
+}
+
+/// Convert a uv to unorm16, clamping it to 0..1.
+static inline void sf_encode_unorm16(const sf_vec2 uv, uint16_t out[2]) {
+#if defined(SF_VERTEX_SSE2)
+    __m128 v = _mm_set_ps(0, 0, uv.y, uv.x);
+    v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    // SSE2 can only pack to signed 16 bits, so shift into that range and back.
+    const __m128 scaled = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f));
+    __m128i i = _mm_sub_epi32(_mm_cvttps_epi32(scaled), _mm_set1_epi32(32768));
+    i = _mm_xor_si128(_mm_packs_epi32(i, i), _mm_set1_epi16((short)0x8000));
+    const int packed = _mm_cvtsi128_si32(i);
+    memcpy(out, &packed, 4);
+#else
+    const float x = uv.x < 0 ? 0 : uv.x > 1 ? 1 : uv.x, y = uv.y < 0 ? 0 : uv.y > 1 ? 1 : uv.y;
+    out[0] = (uint16_t)sf_round(x * 65535.0f);
+    out[1] = (uint16_t)sf_round(y * 65535.0f);
+#endif
+}
+
+bool sf_vertex_layout_push(sf_vertex_layout *layout, const GLuint location, const GLint components, const GLenum type, const GLboolean normalized) {
+    if (layout->count == SF_VERTEX_MAX_ATTRIBS || components < 1 || components > 4)
+        return false;
+    switch (type) {
+        case GL_BYTE: case GL_UNSIGNED_BYTE: case GL_SHORT: case GL_UNSIGNED_SHORT:
+        case GL_INT: case GL_UNSIGNED_INT: case GL_HALF_FLOAT: case GL_FLOAT: break;
+        default: return false;
+    }
+    layout->attribs[layout->count++] = (sf_vertex_attrib){
+        .location = location,
+        .components = components,
+        .type = type,
+        .normalized = normalized,
+        .offset = layout->stride,
+    };
+    layout->stride += (uint32_t)components * sf_gl_type_size(type);
+    return true;
+}
+
+sf_vertex_layout sf_vertex_format_layout(const sf_vertex_format format) {
+    sf_vertex_layout layout = {.format = format};
+    switch (format) {
+        case SF_VERTEX_FLOAT:
+            sf_vertex_layout_push(&layout, SF_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_UV, 2, GL_FLOAT, GL_FALSE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE);
+            break;
+        case SF_VERTEX_COMPACT:
+            sf_vertex_layout_push(&layout, SF_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+            break;
+        case SF_VERTEX_HALF:
+            sf_vertex_layout_push(&layout, SF_ATTRIB_POSITION, 4, GL_HALF_FLOAT, GL_FALSE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_UV, 2, GL_HALF_FLOAT, GL_FALSE);
+            sf_vertex_layout_push(&layout, SF_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+            break;
+        case SF_VERTEX_POSITION:
+            sf_vertex_layout_push(&layout, SF_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE);
+            break;
+        default: break;
+    }
+    return layout;
+}
+
+const sf_vertex_attrib *sf_vertex_layout_find(const sf_vertex_layout *layout, const GLuint location) {
+    for (uint8_t i = 0; i < layout->count; ++i)
+        if (layout->attribs[i].location == location)
+            return layout->attribs + i;
+    return NULL;
+}
+
+static inline float sf_clampf(const float v, const float min, const float max) { return v < min ? min : v > max ? max : v; }
+
+/// Write one attribute from up to four float components.
+/// Missing components are 0, except w which is 1 like OpenGL's defaults.
+void sf_encode_attrib(const sf_vertex_attrib *attrib, const float *src, const GLint src_count, uint8_t *out) {
+    for (GLint c = 0; c < attrib->components; ++c) {
+        const float v = c < src_count ? src[c] : c == 3 ? 1.0f : 0.0f;
+        const bool n = attrib->normalized;
+        switch (attrib->type) {
+            case GL_HALF_FLOAT: {
+                const uint16_t h = sf_float_half(v);
+                memcpy(out + c * 2, &h, 2);
+            } break;
+            case GL_UNSIGNED_BYTE: out[c] = (uint8_t)sf_round(n ? sf_clampf(v, 0, 1) * 255.0f : sf_clampf(v, 0, UINT8_MAX)); break;
+            case GL_BYTE: {
+                const int8_t b = (int8_t)sf_round(n ? sf_clampf(v, -1, 1) * 127.0f : sf_clampf(v, INT8_MIN, INT8_MAX));
+                memcpy(out + c, &b, 1);
+            } break;
+            case GL_UNSIGNED_SHORT: {
+                const uint16_t u = (uint16_t)sf_round(n ? sf_clampf(v, 0, 1) * 65535.0f : sf_clampf(v, 0, UINT16_MAX));
+                memcpy(out + c * 2, &u, 2);
+            } break;
+            case GL_SHORT: {
+                const int16_t i = (int16_t)sf_round(n ? sf_clampf(v, -1, 1) * 32767.0f : sf_clampf(v, INT16_MIN, INT16_MAX));
+                memcpy(out + c * 2, &i, 2);
+            } break;
+            case GL_UNSIGNED_INT: {
+                const uint32_t u = (uint32_t)(n ? sf_round_clamped(v * 4294967295.0, 0, 4294967295.0) : sf_round_clamped(v, 0, UINT32_MAX));
+                memcpy(out + c * 4, &u, 4);
+            } break;
+            case GL_INT: {
+                const int32_t i = (int32_t)(n ? sf_round_clamped(v * 2147483647.0, -2147483647.0, 2147483647.0) : sf_round_clamped(v, INT32_MIN, INT32_MAX));
+                memcpy(out + c * 4, &i, 4);
+            } break;
+            case GL_FLOAT: memcpy(out + c * 4, &v, 4); break;
+            // Layouts pushed can't have other types, but hand-built ones may.
+            default: memset(out + (uint32_t)c * sf_gl_type_size(attrib->type), 0, sf_gl_type_size(attrib->type)); break;
+        }
+    }
+}
+
+void sf_vertex_encode(const sf_vertex_layout *layout, const sf_vertex *vertices, void *out, const size_t count) {
+    switch (layout->format) {
+        case SF_VERTEX_FLOAT:
+            memcpy(out, vertices, count * sizeof(sf_vertex));
+            return;
+        case SF_VERTEX_COMPACT: {
+            sf_vertex_compact *compact = out;
+            for (size_t i = 0; i < count; ++i) {
+                compact[i].position = vertices[i].position;
+                sf_encode_unorm16(vertices[i].uv, compact[i].uv);
+                sf_encode_rgba8(vertices[i].color, compact[i].color);
+            }
+        } return;
+        case SF_VERTEX_HALF: {
+            sf_vertex_half *half = out;
+            for (size_t i = 0; i < count; ++i) {
+                half[i].position[0] = sf_float_half(vertices[i].position.x);
+                half[i].position[1] = sf_float_half(vertices[i].position.y);
+                half[i].position[2] = sf_float_half(vertices[i].position.z);
+                half[i].position[3] = sf_float_half(1.0f);
+                half[i].uv[0] = sf_float_half(vertices[i].uv.x);
+                half[i].uv[1] = sf_float_half(vertices[i].uv.y);
+                sf_encode_rgba8(vertices[i].color, half[i].color);
+            }
+        } return;
+        case SF_VERTEX_POSITION: {
+            sf_vec3 *positions = out;
+            for (size_t i = 0; i < count; ++i)
+                positions[i] = vertices[i].position;
+        } return;
+        default: break;
+    }
+
+    uint8_t *bytes = out;
+    memset(bytes, 0, count * layout->stride);
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t *vertex = bytes + i * layout->stride;
+        const float position[3] = {vertices[i].position.x, vertices[i].position.y, vertices[i].position.z};
+        const float uv[2] = {vertices[i].uv.x, vertices[i].uv.y};
+        for (uint8_t a = 0; a < layout->count; ++a) {
+            const sf_vertex_attrib *attrib = layout->attribs + a;
+            switch (attrib->location) {
+                case SF_ATTRIB_POSITION: sf_encode_attrib(attrib, position, 3, vertex + attrib->offset); break;
+                case SF_ATTRIB_UV: sf_encode_attrib(attrib, uv, 2, vertex + attrib->offset); break;
+                case SF_ATTRIB_COLOR: sf_encode_attrib(attrib, vertices[i].color.gl, 4, vertex + attrib->offset); break;
+                default: break;
+            }
+        }
+    }
+}
+
+void sf_vertex_attrib_decode(const sf_vertex_attrib *attrib, const void *vertex, float out[4]) {
+    const uint8_t *in = (const uint8_t *)vertex + attrib->offset;
+    const bool n = attrib->normalized;
+    for (GLint c = 0; c < 4; ++c) {
+        float v = c == 3 ? 1.0f : 0.0f;
+        if (c < attrib->components) {
+            switch (attrib->type) {
+                case GL_HALF_FLOAT: {
+                    uint16_t h;
+                    memcpy(&h, in + c * 2, 2);
+                    v = sf_half_float(h);
+                } break;
+                case GL_UNSIGNED_BYTE: v = n ? in[c] / 255.0f : in[c]; break;
+                case GL_BYTE: {
+                    int8_t b;
+                    memcpy(&b, in + c, 1);
+                    v = n ? sf_clampf(b / 127.0f, -1, 1) : b;
+                } break;
+                case GL_UNSIGNED_SHORT: {
+                    uint16_t u;
+                    memcpy(&u, in + c * 2, 2);
+                    v = n ? u / 65535.0f : u;
+                } break;
+                case GL_SHORT: {
+                    int16_t i;
+                    memcpy(&i, in + c * 2, 2);
+                    v = n ? sf_clampf(i / 32767.0f, -1, 1) : i;
+                } break;
+                case GL_FLOAT: memcpy(&v, in + c * 4, 4); break;
+                default: v = 0; break;
+            }
+        }
+        out[c] = v;
+    }
+}
+
+void sf_vertex_positions(const sf_vertex_layout *layout, const void *vertices, const size_t count, sf_vec3 *out) {
+    const sf_vertex_attrib *attrib = sf_vertex_layout_find(layout, SF_ATTRIB_POSITION);
+    const uint8_t *bytes = vertices;
+    if (attrib && attrib->type == GL_FLOAT && attrib->components >= 3) {
+        for (size_t i = 0; i < count; ++i)
+            memcpy(out + i, bytes + i * layout->stride + attrib->offset, sizeof(sf_vec3));
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        float v[4] = {0, 0, 0, 1};
+        if (attrib)
+            sf_vertex_attrib_decode(attrib, bytes + i * layout->stride, v);
+        out[i] = (sf_vec3){v[0], v[1], v[2]};
+    }
+}
+
+sf_vertex_data sf_vertex_data_new(const size_t stride) {
+    return (sf_vertex_data){
+        .data = NULL,
+        .count = 0,
+        .capacity = 0,
+        .stride = stride,
+    };
+}
+
+void sf_vertex_data_free(sf_vertex_data *data) {
+    free(data->data);
+    *data = sf_vertex_data_new(data->stride);
+}
+
+void sf_vertex_data_reserve(sf_vertex_data *data, const size_t count) {
+    if (count <= data->capacity)
+        return;
+    size_t capacity = data->capacity < 16 ? 16 : data->capacity;
+    while (capacity < count)
+        capacity *= 2;
+    data->data = realloc(data->data, capacity * data->stride);
+    data->capacity = capacity;
+}
+
+sf_index_data sf_index_data_new(void) {
+    return (sf_index_data){
+        .data = NULL,
+        .count = 0,
+        .capacity = 0,
+        .type = GL_UNSIGNED_SHORT,
+    };
+}
+
+void sf_index_data_free(sf_index_data *data) {
+    free(data->data);
+    *data = sf_index_data_new();
+}
+
+void sf_index_data_reserve(sf_index_data *data, const size_t count) {
+    if (count <= data->capacity)
+        return;
+    size_t capacity = data->capacity < 16 ? 16 : data->capacity;
+    while (capacity < count)
+        capacity *= 2;
+    data->data = realloc(data->data, capacity * sf_index_size(data->type));
+    data->capacity = capacity;
+}
+
+void sf_index_data_widen(sf_index_data *data) {
+    if (data->type == GL_UNSIGNED_INT)
+        return;
+    data->type = GL_UNSIGNED_INT;
+    if (data->capacity == 0)
+        return;
+
+    // Convert back to front so nothing is overwritten before it's read.
+    data->data = realloc(data->data, data->capacity * sizeof(uint32_t));
+    const uint16_t *narrow = data->data;
+    uint32_t *wide = data->data;
+    for (size_t i = data->count; i-- > 0;)
+        wide[i] = narrow[i];
+}
+
+sf_vertex_table sf_vertex_table_new(void) {
+    return (sf_vertex_table){
+        .slots = NULL,
+        .capacity = 0,
+        .count = 0,
+    };
+}
+
+void sf_vertex_table_free(sf_vertex_table *table) {
+    free(table->slots);
+    *table = sf_vertex_table_new();
+}
+
+void sf_vertex_table_rehash(sf_vertex_table *table, const size_t capacity) {
+    sf_vertex_slot *slots = malloc(capacity * sizeof(sf_vertex_slot));
+    for (size_t i = 0; i < capacity; ++i)
+        slots[i].index = SF_VERTEX_NONE;
+
+    // Every existing entry is unique, so only an empty slot has to be found.
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < table->capacity; ++i) {
+        const sf_vertex_slot slot = table->slots[i];
+        if (slot.index == SF_VERTEX_NONE)
+            continue;
+        size_t s = (size_t)slot.hash & mask;
+        while (slots[s].index != SF_VERTEX_NONE)
+            s = (s + 1) & mask;
+        slots[s] = slot;
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+}
+
+void sf_vertex_table_reserve(sf_vertex_table *table, const size_t count) {
+    if (count <= SF_VERTEX_TABLE_LOAD(table->capacity))
+        return;
+    size_t capacity = table->capacity < SF_VERTEX_TABLE_MIN ? SF_VERTEX_TABLE_MIN : table->capacity;
+    while (count > SF_VERTEX_TABLE_LOAD(capacity))
+        capacity *= 2;
+    sf_vertex_table_rehash(table, capacity);
+}
+
+uint32_t sf_vertex_table_find(const sf_vertex_table *table, const void *pool, const size_t stride, const void *vertex, const uint64_t hash) {
+    if (table->count == 0)
+        return SF_VERTEX_NONE;
+
+    const uint8_t *bytes = pool;
+    const size_t mask = table->capacity - 1;
+    for (size_t s = (size_t)hash & mask;; s = (s + 1) & mask) {
+        const sf_vertex_slot slot = table->slots[s];
+        if (slot.index == SF_VERTEX_NONE)
+            return SF_VERTEX_NONE;
+        if (slot.hash == hash && sf_vertex_eq(bytes + (size_t)slot.index * stride, vertex, stride))
+            return slot.index;
+    }
+}
+
+uint32_t sf_vertex_table_intern(sf_vertex_table *table, const void *pool, const size_t stride, const void *vertex, const uint64_t hash, const uint32_t index) {
+    sf_vertex_table_reserve(table, table->count + 1);
+
+    const uint8_t *bytes = pool;
+    const size_t mask = table->capacity - 1;
+    size_t s = (size_t)hash & mask;
+    for (;; s = (s + 1) & mask) {
+        const sf_vertex_slot slot = table->slots[s];
+        if (slot.index == SF_VERTEX_NONE)
+            break;
+        if (slot.hash == hash && sf_vertex_eq(bytes + (size_t)slot.index * stride, vertex, stride))
+            return slot.index;
+    }
+
+    table->slots[s] = (sf_vertex_slot){hash, index};
+    table->count++;
+    return index;
+}
+
+void sf_vertex_table_rebuild(sf_vertex_table *table, const void *pool, const size_t stride, const size_t count) {
+    sf_vertex_table_free(table);
+    sf_vertex_table_reserve(table, count);
+    const uint8_t *bytes = pool;
+    for (size_t v = 0; v < count; ++v)
+        sf_vertex_table_intern(table, pool, stride, bytes + v * stride, sf_vertex_hash(bytes + v * stride, stride), (uint32_t)v);
+}
+
+/// One thread's share of sf_vertex_table_dedup.
+typedef struct {
+    const sf_vertex_table *table;
+    const uint8_t *pool;
+    sf_vertex_batch *batch;
+    uint8_t *known;
+
+    /// The slice of the batch this thread hashes.
+    size_t begin, end;
+    /// The positions of the batch that fall in this thread's shard, in ascending order.
+    const uint32_t *positions;
+    size_t position_count;
+} sf_dedup_work;
+
+static inline size_t sf_dedup_shard_of(const uint64_t hash, const size_t shards) {
+    // The high bits, since the low ones pick the slot inside each shard's table.
+    return (size_t)(hash >> 32) % shards;
+}
+
+void sf_dedup_hash(void *arg) {
+    const sf_dedup_work *work = arg;
+    const sf_vertex_batch *batch = work->batch;
+    const uint8_t *vertices = batch->vertices;
+    for (size_t i = work->begin; i < work->end; ++i)
+        batch->hashes[i] = sf_vertex_hash(vertices + i * batch->stride, batch->stride);
+}
+
+void sf_dedup_shard(void *arg) {
+    const sf_dedup_work *work = arg;
+    const sf_vertex_batch *batch = work->batch;
+    const uint8_t *vertices = batch->vertices;
+    const size_t stride = batch->stride;
+
+    // Vertices equal to each other always land in the same shard, so the shard's first
+    // occurrence of a vertex is its first occurrence in the whole batch.
+    sf_vertex_table local = sf_vertex_table_new();
+    sf_vertex_table_reserve(&local, work->position_count);
+    for (size_t i = 0; i < work->position_count; ++i) {
+        const uint32_t p = work->positions[i];
+        const uint8_t *vertex = vertices + (size_t)p * stride;
+        const uint64_t hash = batch->hashes[p];
+
+        const uint32_t existing = sf_vertex_table_find(work->table, work->pool, stride, vertex, hash);
+        if (existing != SF_VERTEX_NONE) {
+            batch->remap[p] = existing;
+            work->known[p] = 1;
+            continue;
+        }
+        batch->remap[p] = sf_vertex_table_intern(&local, vertices, stride, vertex, hash, p);
+        work->known[p] = 0;
+    }
+    sf_vertex_table_free(&local);
+}
+
+size_t sf_vertex_table_dedup(const sf_vertex_table *table, const void *pool, sf_vertex_batch *batch, const uint32_t base, const uint32_t threads) {
+    const size_t count = batch->count;
+    if (count == 0)
+        return 0;
+    // A single shard runs on the calling thread, so small batches start no threads at all.
+    const size_t most = count / SF_VERTEX_DEDUP_PER_THREAD;
+    const size_t shards = threads <= 1 || most <= 1 ? 1 : threads < most ? threads : most;
+
+    sf_dedup_work *work = calloc(shards, sizeof(sf_dedup_work));
+    size_t *offsets = calloc(shards + 1, sizeof(size_t));
+    uint32_t *positions = malloc(count * sizeof(uint32_t));
+    uint8_t *known = malloc(count);
+
+    for (size_t s = 0; s < shards; ++s) {
+        work[s] = (sf_dedup_work){
+            .table = table,
+            .pool = pool,
+            .batch = batch,
+            .known = known,
+            .begin = count * s / shards,
+            .end = count * (s + 1) / shards,
+        };
+    }
+    sf_thread_run(sf_dedup_hash, work, sizeof(sf_dedup_work), shards);
+
+    // Counting sort of positions by shard, which keeps each shard in ascending order.
+    for (size_t p = 0; p < count; ++p)
+        offsets[sf_dedup_shard_of(batch->hashes[p], shards) + 1]++;
+    for (size_t s = 0; s < shards; ++s)
+        offsets[s + 1] += offsets[s];
+    for (size_t s = 0; s < shards; ++s) {
+        work[s].positions = positions + offsets[s];
+        work[s].position_count = offsets[s + 1] - offsets[s];
+    }
+    for (size_t p = 0; p < count; ++p)
+        positions[offsets[sf_dedup_shard_of(batch->hashes[p], shards)]++] = (uint32_t)p;
+    sf_thread_run(sf_dedup_shard, work, sizeof(sf_dedup_work), shards);
+
+    // Stitch: a first occurrence gets the next index, and every later copy points back at one.
+    size_t added = 0;
+    for (size_t p = 0; p < count; ++p) {
+        if (known[p])
+            continue;
+        const uint32_t first = batch->remap[p];
+        if (first == p) {
+            batch->remap[p] = base + (uint32_t)added;
+            batch->unique[added++] = (uint32_t)p;
+        } else batch->remap[p] = batch->remap[first];
+    }
+
+    free(known);
+    free(positions);
+    free(offsets);
+    free(work);
+    return added;
+}
@@ -44,6 +44,13 @@ void APIENTRY sf_gl_dbglog(GLuint source, GLuint type, GLuint id, GLuint severit
     printf("[OpenGL] (Source %u) (Type %u) (ID %u), (Severity %u) \"%s\"\n", source, type, id, severity, message);
 }
 
+/// Make a window's context and state cache current, if they aren't already.
+static void sf_window_make_current(sf_window *window) {
+    if (glfwGetCurrentContext() != window->handle)
+        glfwMakeContextCurrent(window->handle);
+    sf_gl_state_use(&window->gl);
+}
+
 sf_window_ex sf_window_new(const sf_str title, const sf_vec2 size, sf_camera *camera, const uint8_t hints) {
     sf_window *win = calloc(1, sizeof(sf_window));
     *win = (sf_window){
@@ -51,6 +58,7 @@ sf_window_ex sf_window_new(const sf_str title, const sf_vec2 size, sf_camera *ca
         .size = size,
         .mouse_position = { 0, 0 },
         .hints = hints,
+        .gl = SF_GL_STATE_UNKNOWN,
     };
 
     glfwSetErrorCallback(sf_cb_err);
@@ -67,8 +75,14 @@ sf_window_ex sf_window_new(const sf_str title, const sf_vec2 size, sf_camera *ca
     if (!((win->handle = glfwCreateWindow((int)size.x, (int)size.y, title.c_str, NULL, NULL))))
         return sf_window_ex_err(SF_GLFW_CREATE_FAILED);
     glfwMakeContextCurrent(win->handle);
+    sf_gl_state_use(&win->gl);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
         return sf_window_ex_err(SF_GLAD_INIT_FAILED);
+    // Glad isn't generated with the extension, so its one function is loaded by hand, under either name.
+    GLFWglproc max_threads = glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+    if (!max_threads)
+        max_threads = glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+    sf_shader_parallel_init((sf_max_threads_proc)max_threads);
 
     glfwSetWindowUserPointer(win->handle, win); // Point to myself
     glfwSetKeyCallback(win->handle, sf_cb_key);
@@ -91,7 +105,7 @@ sf_window_ex sf_window_new(const sf_str title, const sf_vec2 size, sf_camera *ca
     glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
     glDebugMessageCallback(sf_gl_dbglog, NULL);
     #endif
-    glEnable(GL_DEPTH_TEST);
+    sf_gl_set(GL_DEPTH_TEST, true);
 
     if ((hints & SF_WINDOW_VISIBLE) == SF_WINDOW_VISIBLE)
         glfwShowWindow(win->handle);
@@ -115,9 +129,13 @@ sf_window_ex sf_window_new(const sf_str title, const sf_vec2 size, sf_camera *ca
 }
 
 void sf_window_close(sf_window *window) {
+    sf_window_make_current(window);
     sf_str_free(window->title);
+    sf_render_queue_free(&window->queue);
     sf_mesh_delete(&window->fb_mesh);
+    sf_camera_blocks_free();
     glfwDestroyWindow(window->handle);
+    sf_gl_state_use(NULL);
 }
 
 sf_str sf_key_string(sf_window *window) {
@@ -135,8 +153,8 @@ void sf_window_set_camera(sf_window *window, sf_camera *camera) {
 
     if (camera->framebuffer == 0) {
         glGenFramebuffers(1, &camera->framebuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, camera->framebuffer);
-        glViewport(0, 0, (int)camera->viewport.x, (int)camera->viewport.y);
+        sf_gl_bind_framebuffer(camera->framebuffer);
+        sf_gl_viewport(0, 0, (int)camera->viewport.x, (int)camera->viewport.y);
         glDrawBuffers(1, (GLenum[]){GL_COLOR_ATTACHMENT0});
 
         camera->fb_color = sf_texture_new(SF_TEXTURE_RGBA, window->size);
@@ -144,8 +162,8 @@ void sf_window_set_camera(sf_window *window, sf_camera *camera) {
 
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, camera->fb_color.handle, 0);
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, camera->fb_stencil.handle, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, (int)window->size.x, (int)window->size.y);
+        sf_gl_bind_framebuffer(0);
+        sf_gl_viewport(0, 0, (int)window->size.x, (int)window->size.y);
     } else {
         sf_texture_resize(&camera->fb_color, window->size);
         sf_texture_resize(&camera->fb_stencil, window->size);
@@ -154,14 +172,16 @@ void sf_window_set_camera(sf_window *window, sf_camera *camera) {
     window->camera = camera;
 }
 
-bool sf_window_loop(const sf_window *window) {
+bool sf_window_loop(sf_window *window) {
     //TODO: Prepare for frame.
-    glfwMakeContextCurrent(window->handle);
+    sf_window_make_current(window);
     sf_opengl_log();
     glfwPollEvents();
+    if (window->reloader)
+        sf_reloader_apply(window->reloader);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, window->camera->framebuffer);
-    glViewport(0, 0, (int)window->size.x, (int)window->size.y);
+    sf_gl_bind_framebuffer(window->camera->framebuffer);
+    sf_gl_viewport(0, 0, (int)window->size.x, (int)window->size.y);
     const sf_glcolor gl = sf_rgbagl(window->camera->clear_color);
     glClearColor(gl.rgba.r, gl.rgba.g, gl.rgba.b, gl.rgba.a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -170,19 +190,27 @@ bool sf_window_loop(const sf_window *window) {
 }
 
 sf_draw_ex sf_window_draw(sf_window *window, sf_shader *post_shader) {
-    glfwMakeContextCurrent(window->handle);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, (int)window->size.x, (int)window->size.y);
+    sf_window_make_current(window);
+    const sf_draw_ex queued = sf_render_queue_flush(&window->queue);
+    sf_gl_bind_framebuffer(0);
+    sf_gl_viewport(0, 0, (int)window->size.x, (int)window->size.y);
     const sf_glcolor gl = sf_rgbagl(SF_RENDER_DEFAULT->clear_color);
     glClearColor(gl.rgba.r, gl.rgba.g, gl.rgba.b, gl.rgba.a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    glDisable(GL_DEPTH_TEST);
+    sf_gl_set(GL_DEPTH_TEST, false);
     sf_camera fb = sf_render_default(window->size);
     const sf_draw_ex res = sf_mesh_draw(&window->fb_mesh, post_shader, &fb, SF_TRANSFORM_IDENTITY, &window->camera->fb_color);
-    glEnable(GL_DEPTH_TEST);
+    sf_gl_set(GL_DEPTH_TEST, true);
     glfwSwapBuffers(window->handle);
-
+    // The post pass belongs to this frame, so both are read once it's drawn.
+    window->stats = window->gl.draws;
+    window->gl.draws = (sf_draw_stats){0};
+    window->gl_calls = window->gl.counters;
+    window->gl.counters = (sf_gl_counters){0};
+
+    if (!queued.is_ok)
+        return queued;
     if (!res.is_ok)
         return res;
 
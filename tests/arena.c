@@ -0,0 +1,28 @@
+#include "sf/gfx/arena.h"
+#include <stdio.h>
+
+int main(void) {
+    // Arena ranges: first fit, and released neighbours merge back into one range.
+    sf_arena_allocator arena = sf_arena_allocator_new(100);
+    const size_t a0 = sf_arena_alloc(&arena, 30), a1 = sf_arena_alloc(&arena, 30), a2 = sf_arena_alloc(&arena, 30);
+    if (a0 != 0 || a1 != 30 || a2 != 60 || sf_arena_alloc(&arena, 20) != SF_ARENA_NONE) {
+        fprintf(stderr, "Arena allocations are out of place\n");
+        return -1;
+    }
+    sf_arena_release(&arena, (sf_arena_range){a0, 30});
+    sf_arena_release(&arena, (sf_arena_range){a2, 30});
+    if (arena.count != 2 || sf_arena_free_size(&arena) != 70 || sf_arena_fragmentation(&arena) <= 0.0f
+        || sf_arena_alloc(&arena, 10) != 0) {
+        fprintf(stderr, "Arena free list is wrong after releasing\n");
+        return -1;
+    }
+    sf_arena_release(&arena, (sf_arena_range){0, 10});
+    sf_arena_release(&arena, (sf_arena_range){a1, 30});
+    sf_arena_grow(&arena, 200);
+    if (arena.count != 1 || arena.free[0].offset != 0 || arena.free[0].size != 200 || sf_arena_fragmentation(&arena) != 0.0f) {
+        fprintf(stderr, "Arena ranges didn't merge back together\n");
+        return -1;
+    }
+    sf_arena_allocator_free(&arena);
+    return 0;
+}
@@ -0,0 +1,7 @@
+// The camera block sepgfx binds for every draw.
+layout(std140) uniform sf_camera {
+    mat4 c_projection;
+    mat4 c_view;
+    vec4 c_position;
+    vec4 c_viewport;
+};
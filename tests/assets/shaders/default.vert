@@ -7,12 +7,11 @@ layout(location = 2) in vec4 vc_vcolor;
 out vec2 fv2_uv;
 out vec4 fc_vcolor;
 
-uniform mat4 m_projection;
-uniform mat4 m_campos;
+#include "camera.glsl"
 uniform mat4 m_model;
 
 void main() {
-    gl_Position = m_projection * m_campos * m_model * vec4(vv3_pos, 1.0);
+    gl_Position = c_projection * c_view * m_model * vec4(vv3_pos, 1.0);
     fv2_uv = vv2_uv;
     fc_vcolor = vc_vcolor;
-}
\ No newline at end of file
+}
@@ -0,0 +1,13 @@
+#version 410 core
+layout(location = 0) in vec3 vv3_pos;
+layout(location = 1) in vec2 vv2_uv;
+layout(location = 2) in vec4 vc_vcolor;
+layout(location = 12) in mat4 im_model;
+out vec2 fv2_uv;
+out vec4 fc_vcolor;
+#include "camera.glsl"
+void main() {
+    gl_Position = c_projection * c_view * im_model * vec4(vv3_pos, 1.0);
+    fv2_uv = vv2_uv;
+    fc_vcolor = vc_vcolor;
+}
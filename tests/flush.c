@@ -0,0 +1,68 @@
+#include "sf/gfx/camera.h"
+#include "sf/gfx/meshes.h"
+#include "sf/gfx/queue.h"
+#include "sf/math.h"
+#include <sf/gfx/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(void) {
+    // A hidden window, for its context; everything is drawn through a queue of its own.
+    sf_camera *camera = calloc(1, sizeof(sf_camera));
+    *camera = sf_camera_new(SF_CAMERA_PERSPECTIVE, 90, 0.1f, 100.0f);
+    const sf_window_ex wx = sf_window_new(sf_lit("Flush Test"), (sf_vec2){64, 64}, camera, 0);
+    if (!wx.is_ok) {
+        fprintf(stderr, "Couldn't open a window\n");
+        return -1;
+    }
+    sf_window *win = wx.value.ok;
+    const sf_shader_ex sx = sf_shader_new(sf_lit("tests/assets/shaders/default"));
+    if (!sx.is_ok) {
+        fprintf(stderr, "Default shader failed\n");
+        return -1;
+    }
+    sf_shader def = sx.value.ok;
+
+    const sf_vertex tri[3] = {
+        {{0, 0, -5}, {0, 0}, sf_rgbagl(SF_WHITE)},
+        {{1, 0, -5}, {1, 0}, sf_rgbagl(SF_WHITE)},
+        {{0, 1, -5}, {0, 1}, sf_rgbagl(SF_WHITE)},
+    };
+    sf_mesh mesh = sf_mesh_new();
+    sf_mesh_add_vertices(&mesh, tri, 3);
+    const sf_texture texture = {0};
+
+    // A draw without a shader sorts first, and fails alone; the draws after it still happen.
+    sf_render_queue queue = sf_render_queue_new();
+    sf_render_queue_push(&queue, &mesh, &def, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_render_queue_push(&queue, &mesh, NULL, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_render_queue_push(&queue, &mesh, &def, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_draw_stats_reset();
+    const sf_draw_ex missing = sf_render_queue_flush(&queue);
+    if (missing.is_ok || missing.value.err.type != SF_DRAW_SHADER_MISSING || sf_draw_stats_get().drawn != 2 || queue.count != 0) {
+        fprintf(stderr, "A draw without a shader wasn't skipped on its own (%zu drawn)\n", sf_draw_stats_get().drawn);
+        return -1;
+    }
+
+    // So is a mesh whose layout can't feed its shader.
+    sf_mesh positions = sf_mesh_new_format(SF_VERTEX_POSITION);
+    sf_mesh_add_vertices(&positions, tri, 3);
+    sf_render_queue_push(&queue, &positions, &def, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_render_queue_push(&queue, &mesh, &def, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_render_queue_push(&queue, &positions, &def, camera, SF_TRANSFORM_IDENTITY, &texture);
+    sf_draw_stats_reset();
+    const sf_draw_ex mismatch = sf_render_queue_flush(&queue);
+    if (mismatch.is_ok || mismatch.value.err.type != SF_DRAW_ATTRIB_MISMATCH || sf_draw_stats_get().drawn != 1) {
+        fprintf(stderr, "A mesh that can't feed its shader wasn't skipped on its own (%zu drawn)\n", sf_draw_stats_get().drawn);
+        return -1;
+    }
+
+    sf_render_queue_free(&queue);
+    sf_mesh_delete(&positions);
+    sf_mesh_delete(&mesh);
+    sf_shader_free(&def);
+    sf_window_close(win);
+    sf_camera_delete(camera);
+    free(camera);
+    return 0;
+}
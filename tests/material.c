@@ -0,0 +1,80 @@
+#include "sf/gfx/camera.h"
+#include "sf/gfx/material.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// No context: the few GL calls that get through are caught here, and everything else has to be skipped by the caches.
+static size_t uniform_calls = 0;
+static void APIENTRY test_uniform1f(GLint location, GLfloat value) { (void)location; (void)value; uniform_calls++; }
+static void APIENTRY test_delete_program(GLuint program) { (void)program; }
+static GLint APIENTRY test_uniform_location(GLuint program, const GLchar *name) { (void)program; (void)name; return -1; }
+
+/// A linked shader as far as sepgfx can tell, with a sampler and a tint whose values are already known.
+static sf_shader test_shader(const GLuint program, const float tint) {
+    sf_shader shader = {.path = sf_str_fmt("tests/material"), .program = program, .uniforms = sf_uniform_map_new()};
+    shader.uniform_info = malloc(2 * sizeof(sf_uniform_info));
+    shader.uniform_info[0] = (sf_uniform_info){sf_str_fmt("t_sampler"), 0, GL_SAMPLER_2D, 1, {0}, true, false};
+    shader.uniform_info[1] = (sf_uniform_info){sf_str_fmt("u_tint"), 1, GL_FLOAT, 1, {tint}, true, false};
+    shader.uniform_count = 2;
+    for (uint32_t i = 0; i < shader.uniform_count; ++i)
+        sf_uniform_map_set(&shader.uniforms, shader.uniform_info[i].name, i);
+    shader.u_model = shader.u_sampler = shader.u_projection = shader.u_campos = SF_UNIFORM_NONE;
+    return shader;
+}
+
+int main(void) {
+    glad_glUniform1f = test_uniform1f;
+    glad_glDeleteProgram = test_delete_program;
+    glad_glGetUniformLocation = test_uniform_location;
+
+    sf_shader shader = test_shader(7, 0.5f);
+    sf_texture texture = {0};
+    texture.handle = 11;
+    // The shader's program and texture are already bound.
+    sf_gl_current->program = shader.program;
+    sf_gl_current->textures[0] = texture.handle;
+
+    sf_material material = sf_material_new(&shader);
+    const sf_uniform_ex bad_slot = sf_material_set_texture(&material, SF_MATERIAL_TEXTURES, sf_lit("t_sampler"), &texture);
+    if (bad_slot.is_ok || bad_slot.value.err.type != SF_SHADER_UNKNOWN_SLOT) {
+        fprintf(stderr, "A missing texture slot wasn't reported as one\n");
+        return -1;
+    }
+    if (!sf_material_set_texture(&material, 0, sf_lit("t_sampler"), &texture).is_ok || !sf_material_set_float(&material, sf_lit("u_tint"), 0.5f).is_ok) {
+        fprintf(stderr, "Couldn't set up a material\n");
+        return -1;
+    }
+
+    // Everything the material sets is already in place, so applying it writes nothing, and applying it again is skipped whole.
+    sf_material_apply(&material);
+    const size_t skipped = sf_gl_current->counters.skipped;
+    sf_material_apply(&material);
+    if (shader.material != &material || uniform_calls != 0 || sf_gl_current->counters.skipped != skipped + 1) {
+        fprintf(stderr, "An applied material wasn't skipped (%zu uniforms written)\n", uniform_calls);
+        return -1;
+    }
+
+    // Writing one of its uniforms from outside makes the shader forget the material, so the next apply puts it back.
+    sf_shader_set_float(&shader, sf_shader_uniform_id(&shader, sf_lit("u_tint")), 2.0f);
+    if (shader.material != NULL || uniform_calls != 1) {
+        fprintf(stderr, "An outside write didn't make the shader forget its material\n");
+        return -1;
+    }
+    sf_material_apply(&material);
+    if (shader.material != &material || uniform_calls != 2) {
+        fprintf(stderr, "A forgotten material wasn't applied again\n");
+        return -1;
+    }
+
+    // A new program has none of the material's values.
+    sf_shader with = test_shader(8, 0);
+    sf_shader_replace(&shader, &with);
+    if (shader.material != NULL || shader.program != 8) {
+        fprintf(stderr, "Replacing a shader's program kept its material\n");
+        return -1;
+    }
+
+    sf_material_free(&material);
+    sf_shader_free(&shader);
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "sf/gfx/camera.h"
+#include "sf/gfx/shaders.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// How many times a needle appears in a haystack.
+static size_t count_of(const char *haystack, const char *needle) {
+    size_t count = 0;
+    for (const char *at = strstr(haystack, needle); at; at = strstr(at + 1, needle))
+        count++;
+    return count;
+}
+
+static const char *common = "#include \"math.glsl\"\nfloat common_value;\n";
+static const char *math = "float math_value;";
+static const char *root = "#include \"inc.glsl\"\n";
+static const char *inc = "float root_value;\n";
+
+int main(void) {
+    const sf_shader_file files[] = {
+        {"lib/common.glsl", common, strlen(common)},
+        {"lib/math.glsl", math, strlen(math)},
+        {"/root.glsl", root, strlen(root)},
+        {"/inc.glsl", inc, strlen(inc)},
+    };
+    sf_shader_embed(files, sizeof(files) / sizeof(files[0]));
+
+    // Nested includes are expanded once each, and the ones in comments not at all.
+    const char *source =
+        "#version 330 core\n"
+        "/* #include \"missing.glsl\"\n"
+        "#include \"missing.glsl\" */\n"
+        "#include \"common.glsl\"\n"
+        "#include \"math.glsl\"\n"
+        "void main() {}\n";
+    const sf_source_ex expanded = sf_shader_preprocess(source, sf_lit("lib"), "#define LIGHTS 4\n");
+    if (!expanded.is_ok) {
+        fprintf(stderr, "Preprocessing failed: %s\n", expanded.value.err.compile_err.c_str);
+        return -1;
+    }
+    const char *text = expanded.value.ok;
+    if (count_of(text, "float math_value;\n") != 1 || count_of(text, "float common_value;") != 1) {
+        fprintf(stderr, "Includes weren't expanded once each:\n%s\n", text);
+        return -1;
+    }
+    if (count_of(text, "#include \"missing.glsl\"") != 2) {
+        fprintf(stderr, "Includes in a comment were touched:\n%s\n", text);
+        return -1;
+    }
+
+    // Defines go right after #version, before anything included.
+    if (strncmp(text, "#version 330 core\n#define LIGHTS 4\n", 35) != 0) {
+        fprintf(stderr, "Defines weren't put after #version:\n%s\n", text);
+        return -1;
+    }
+    free(expanded.value.ok);
+
+    // Includes of a file at the root are found at the root.
+    const sf_source_ex rooted = sf_shader_source(sf_lit("/root.glsl"), NULL);
+    if (!rooted.is_ok || count_of(rooted.value.ok, "float root_value;") != 1) {
+        fprintf(stderr, "An include next to a file at the root wasn't found\n");
+        return -1;
+    }
+    free(rooted.value.ok);
+
+    // Defines in any order, or repeated, make the same variant.
+    const sf_str shuffled[] = {sf_lit("SKINNED"), sf_lit("LIGHTS=4"), sf_lit("SKINNED")};
+    const sf_str ordered[] = {sf_lit("LIGHTS=4"), sf_lit("SKINNED")};
+    const sf_str a = sf_shader_variant_defines(shuffled, 3);
+    const sf_str b = sf_shader_variant_defines(ordered, 2);
+    const sf_str none = sf_shader_variant_defines(NULL, 0);
+    if (strcmp(a.c_str, "#define LIGHTS 4\n#define SKINNED\n") != 0 || strcmp(a.c_str, b.c_str) != 0 || none.len != 0) {
+        fprintf(stderr, "Variant defines weren't normalized: '%s' and '%s'\n", a.c_str, b.c_str);
+        return -1;
+    }
+    sf_str_free(a);
+    sf_str_free(b);
+    sf_str_free(none);
+    return 0;
+}
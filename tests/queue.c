@@ -0,0 +1,32 @@
+#include "sf/gfx/queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(void) {
+    // Render keys order by target first and depth last, and the radix sort is stable.
+    if (sf_render_key(1, 0, 0, 0, 0.0f) <= sf_render_key(0, 4095, 4095, 4095, 1.0f)
+        || sf_render_key(0, 1, 1, 1, 0.25f) >= sf_render_key(0, 1, 1, 1, 0.5f)) {
+        fprintf(stderr, "Render keys are ordered wrong\n");
+        return -1;
+    }
+    sf_render_queue queue = sf_render_queue_new();
+    queue.count = queue.capacity = 4096;
+    queue.items = malloc(queue.capacity * sizeof(sf_render_item));
+    queue.scratch = malloc(queue.capacity * sizeof(sf_render_item));
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < queue.count; ++i) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        queue.items[i] = (sf_render_item){sf_render_key((GLuint)(state >> 60), (GLuint)(state >> 50) & 7, 3, (GLuint)(state >> 40) & 15, 0.5f), (uint32_t)i};
+    }
+    sf_render_queue_sort(&queue);
+    for (size_t i = 1; i < queue.count; ++i) {
+        const sf_render_item *a = queue.items + i - 1, *b = queue.items + i;
+        if (a->key > b->key || (a->key == b->key && a->index > b->index)) {
+            fprintf(stderr, "Render queue isn't sorted by key\n");
+            return -1;
+        }
+    }
+    queue.count = 0;
+    sf_render_queue_free(&queue);
+    return 0;
+}
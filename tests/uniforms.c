@@ -0,0 +1,67 @@
+#include "sf/gfx/camera.h"
+#include "sf/gfx/shaders.h"
+#include <sf/gfx/window.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *vertex_source =
+    "#version 330 core\n"
+    "layout(location = 0) in vec3 v_position;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(v_position, 1.0);\n"
+    "}\n";
+
+static const char *fragment_source =
+    "#version 330 core\n"
+    "uniform float u_weights[4];\n"
+    "out vec4 f_color;\n"
+    "void main() {\n"
+    "    f_color = vec4(u_weights[0], u_weights[1], u_weights[2], u_weights[3]);\n"
+    "}\n";
+
+int main(void) {
+    // A hidden window, for its context.
+    sf_camera *camera = calloc(1, sizeof(sf_camera));
+    *camera = sf_camera_new(SF_CAMERA_PERSPECTIVE, 90, 0.1f, 100.0f);
+    const sf_window_ex wx = sf_window_new(sf_lit("Uniforms Test"), (sf_vec2){64, 64}, camera, 0);
+    if (!wx.is_ok) {
+        fprintf(stderr, "Couldn't open a window\n");
+        return -1;
+    }
+    sf_window *win = wx.value.ok;
+    const sf_shader_ex sx = sf_shader_from_memory(sf_lit("tests/uniforms"), vertex_source, fragment_source);
+    if (!sx.is_ok) {
+        fprintf(stderr, "Array shader failed\n");
+        return -1;
+    }
+    sf_shader shader = sx.value.ok;
+
+    // An array's first element is the array, and its others get handles of their own when they're named.
+    const sf_uniform_id array = sf_shader_uniform_id(&shader, sf_lit("u_weights"));
+    const sf_uniform_id first = sf_shader_uniform_id(&shader, sf_lit("u_weights[0]"));
+    const sf_uniform_id third = sf_shader_uniform_id(&shader, sf_lit("u_weights[2]"));
+    if (array == SF_UNIFORM_NONE || first != array || third == SF_UNIFORM_NONE || third == array) {
+        fprintf(stderr, "Array elements didn't resolve (%u, %u, %u)\n", array, first, third);
+        return -1;
+    }
+    if (sf_shader_uniform_id(&shader, sf_lit("u_weights[2]")) != third || sf_shader_uniform_id(&shader, sf_lit("u_weights[9]")) != SF_UNIFORM_NONE) {
+        fprintf(stderr, "Array elements resolved inconsistently\n");
+        return -1;
+    }
+    if (!sf_shader_set_float(&shader, third, 0.5f).is_ok || !sf_shader_uniform_float(&shader, sf_lit("u_weights[1]"), 0.25f).is_ok) {
+        fprintf(stderr, "Couldn't set an array element\n");
+        return -1;
+    }
+    GLfloat read = 0;
+    glGetUniformfv(shader.program, shader.uniform_info[third].location, &read);
+    if (read != 0.5f) {
+        fprintf(stderr, "An array element was set to %f\n", (double)read);
+        return -1;
+    }
+
+    sf_shader_free(&shader);
+    sf_window_close(win);
+    sf_camera_delete(camera);
+    free(camera);
+    return 0;
+}
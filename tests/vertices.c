@@ -0,0 +1,496 @@
+#include "sf/gfx/meshes.h"
+#include "sf/gfx/vertices.h"
+#include <sf/gfx/window.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VERTEX_COUNT 200000
+#define UNIQUE_COUNT 5000
+#define GRID 64
+#define BUMP 17
+
+static sf_vertex make_vertex(const uint32_t seed) {
+    return (sf_vertex){
+        {(float)(seed % 97), (float)(seed % 89), (float)seed},
+        {(float)(seed % 13) / 13.0f, (float)(seed % 7) / 7.0f},
+        sf_rgbagl(SF_WHITE),
+    };
+}
+
+/// A grid vertex on a bumpy surface.
+static sf_vertex grid_vertex(const float x, const float y) {
+    return (sf_vertex){{x, y, sinf(x * 0.3f) * cosf(y * 0.3f) * 2.0f}, {0, 0}, sf_rgbagl(SF_WHITE)};
+}
+
+/// Order independent checksum of a mesh's triangles, by the bytes of their vertices.
+static uint64_t triangle_checksum(const sf_mesh *mesh) {
+    uint64_t sum = 0;
+    for (size_t t = 0; t + 2 < mesh->indices.count; t += 3) {
+        sf_vertex tri[3];
+        for (size_t k = 0; k < 3; ++k)
+            memcpy(tri + k, sf_vertex_data_at(&mesh->vertices, sf_index_data_get(&mesh->indices, t + k)), sizeof(sf_vertex));
+        sum += sf_vertex_hash(tri, sizeof(tri));
+    }
+    return sum;
+}
+
+/// Simplify a flat grid with its middle vertex raised by height until the raised vertex is gone.
+/// Returns the error the simplifier reported, or a negative number if the vertex survived.
+static float bump_error(const float height) {
+    static sf_vec3 positions[BUMP * BUMP];
+    static uint32_t grid[(BUMP - 1) * (BUMP - 1) * 6], out[(BUMP - 1) * (BUMP - 1) * 6];
+    const uint32_t middle = BUMP / 2 * BUMP + BUMP / 2;
+    for (uint32_t v = 0; v < BUMP * BUMP; ++v)
+        positions[v] = (sf_vec3){(float)(v % BUMP), (float)(v / BUMP), v == middle ? height : 0.0f};
+    size_t count = 0;
+    for (uint32_t y = 0; y + 1 < BUMP; ++y) {
+        for (uint32_t x = 0; x + 1 < BUMP; ++x) {
+            const uint32_t a = y * BUMP + x, b = a + 1, c = a + BUMP, d = c + 1;
+            const uint32_t quad[6] = {a, b, c, b, d, c};
+            memcpy(grid + count, quad, sizeof(quad));
+            count += 6;
+        }
+    }
+    float error = 0;
+    const size_t kept = sf_index_simplify(out, grid, count, positions, BUMP * BUMP, 6, &error);
+    for (size_t i = 0; i < kept; ++i) {
+        if (out[i] == middle)
+            return -1;
+    }
+    return error;
+}
+
+int main(void) {
+    sf_vertex *input = malloc(VERTEX_COUNT * sizeof(sf_vertex));
+    sf_vertex *pool = malloc(VERTEX_COUNT * sizeof(sf_vertex));
+    uint32_t *indices = malloc(VERTEX_COUNT * sizeof(uint32_t));
+    if (!input || !pool || !indices) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i)
+        input[i] = make_vertex((i * 7919u) % UNIQUE_COUNT);
+
+    sf_vertex_table table = sf_vertex_table_new();
+    sf_vertex_table_reserve(&table, VERTEX_COUNT);
+    const size_t capacity = table.capacity;
+
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+        const uint64_t hash = sf_vertex_hash(input + i, sizeof(sf_vertex));
+        const uint32_t index = sf_vertex_table_intern(&table, pool, sizeof(sf_vertex), input + i, hash, unique);
+        if (index == unique)
+            pool[unique++] = input[i];
+        indices[i] = index;
+    }
+
+    if (table.capacity != capacity) {
+        fprintf(stderr, "Reserved table was rehashed (%zu -> %zu)\n", capacity, table.capacity);
+        return -1;
+    }
+    if (unique != UNIQUE_COUNT || table.count != UNIQUE_COUNT) {
+        fprintf(stderr, "Expected %d unique vertices, got %u\n", UNIQUE_COUNT, unique);
+        return -1;
+    }
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+        if (!sf_vertex_eq(pool + indices[i], input + i, sizeof(sf_vertex))) {
+            fprintf(stderr, "Vertex %u resolved to the wrong index %u\n", i, indices[i]);
+            return -1;
+        }
+    }
+
+    const sf_vertex missing = make_vertex(UNIQUE_COUNT + 1);
+    if (sf_vertex_table_find(&table, pool, sizeof(sf_vertex), &missing, sf_vertex_hash(&missing, sizeof(sf_vertex))) != SF_VERTEX_NONE) {
+        fprintf(stderr, "Found a vertex that was never inserted\n");
+        return -1;
+    }
+
+    // Parallel deduplication must number vertices exactly like the serial path.
+    sf_vertex_batch batch = {
+        .vertices = input,
+        .count = VERTEX_COUNT,
+        .stride = sizeof(sf_vertex),
+        .remap = malloc(VERTEX_COUNT * sizeof(uint32_t)),
+        .unique = malloc(VERTEX_COUNT * sizeof(uint32_t)),
+        .hashes = malloc(VERTEX_COUNT * sizeof(uint64_t)),
+    };
+    const sf_vertex_table empty = sf_vertex_table_new();
+    size_t added = sf_vertex_table_dedup(&empty, NULL, &batch, 0, 8);
+    if (added != UNIQUE_COUNT || memcmp(batch.remap, indices, VERTEX_COUNT * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Parallel deduplication differs from the serial result\n");
+        return -1;
+    }
+    for (size_t i = 0; i < added; ++i) {
+        if (!sf_vertex_eq(input + batch.unique[i], pool + i, sizeof(sf_vertex))) {
+            fprintf(stderr, "Parallel deduplication found vertex %zu out of order\n", i);
+            return -1;
+        }
+    }
+
+    // A batch too small to split runs on the calling thread, with the same numbering.
+    batch.count = SF_VERTEX_DEDUP_PER_THREAD / 4;
+    added = sf_vertex_table_dedup(&empty, NULL, &batch, 0, 8);
+    if (added > batch.count || memcmp(batch.remap, indices, batch.count * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Deduplicating a small batch differs from the serial result\n");
+        return -1;
+    }
+    batch.count = VERTEX_COUNT;
+
+    // Against a table that already has every vertex, nothing is new.
+    added = sf_vertex_table_dedup(&table, pool, &batch, unique, 3);
+    if (added != 0 || memcmp(batch.remap, indices, VERTEX_COUNT * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Parallel deduplication missed existing vertices\n");
+        return -1;
+    }
+
+    // Compact formats round-trip within their precision.
+    const sf_vertex v = {{1.5f, -2.25f, 1000.0f}, {0.25f, 1.5f}, {{1.0f, 0.5f, 0.0f, -1.0f}}};
+    const sf_vertex_layout compact_layout = sf_vertex_format_layout(SF_VERTEX_COMPACT);
+    const sf_vertex_layout half_layout = sf_vertex_format_layout(SF_VERTEX_HALF);
+    sf_vertex_compact compact;
+    sf_vertex_half half;
+    sf_vertex_encode(&compact_layout, &v, &compact, 1);
+    sf_vertex_encode(&half_layout, &v, &half, 1);
+    if (compact.uv[0] != 16384 || compact.uv[1] != 65535
+        || compact.color[0] != 255 || compact.color[1] != 128 || compact.color[2] != 0 || compact.color[3] != 0) {
+        fprintf(stderr, "Compact vertex encoded incorrectly\n");
+        return -1;
+    }
+    if (sf_half_float(half.position[0]) != 1.5f || sf_half_float(half.position[1]) != -2.25f
+        || sf_half_float(half.position[2]) != 1000.0f || sf_half_float(half.uv[1]) != 1.5f) {
+        fprintf(stderr, "Half vertex encoded incorrectly\n");
+        return -1;
+    }
+
+    // A hand-written layout with the same attributes encodes to the same bytes.
+    sf_vertex_layout custom = {0};
+    sf_vertex_layout_push(&custom, SF_ATTRIB_POSITION, 3, GL_FLOAT, GL_FALSE);
+    sf_vertex_layout_push(&custom, SF_ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE);
+    sf_vertex_layout_push(&custom, SF_ATTRIB_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+    sf_vertex_compact generic;
+    sf_vertex_encode(&custom, &v, &generic, 1);
+    if (custom.stride != sizeof(sf_vertex_compact) || memcmp(&generic, &compact, sizeof(generic)) != 0) {
+        fprintf(stderr, "Custom layout encoded differently from its predefined format\n");
+        return -1;
+    }
+    // A full layout turns more attributes away instead of dropping them unnoticed.
+    sf_vertex_layout full = {0};
+    for (GLuint i = 0; i < SF_VERTEX_MAX_ATTRIBS; ++i)
+        sf_vertex_layout_push(&full, i, 1, GL_FLOAT, GL_FALSE);
+    const uint32_t full_stride = full.stride;
+    if (sf_vertex_layout_push(&full, SF_VERTEX_MAX_ATTRIBS, 1, GL_FLOAT, GL_FALSE)
+        || full.count != SF_VERTEX_MAX_ATTRIBS || full.stride != full_stride) {
+        fprintf(stderr, "A full layout took another attribute\n");
+        return -1;
+    }
+    // So does any layout asked for a type nothing can encode.
+    sf_vertex_layout ints = {0};
+    if (sf_vertex_layout_push(&ints, 0, 3, GL_DOUBLE, GL_FALSE) || sf_vertex_layout_push(&ints, 0, 5, GL_FLOAT, GL_FALSE) || ints.count != 0) {
+        fprintf(stderr, "A layout took an attribute it can't encode\n");
+        return -1;
+    }
+    // 32 bit integers round like the narrower ones, and normalized ones use their whole range.
+    sf_vertex_layout_push(&ints, SF_ATTRIB_POSITION, 3, GL_INT, GL_FALSE);
+    sf_vertex_layout_push(&ints, SF_ATTRIB_UV, 2, GL_UNSIGNED_INT, GL_TRUE);
+    const sf_vertex wide = {{1.5f, -2.5f, 1000.0f}, {1.0f, 0.5f}, {{0, 0, 0, 1}}};
+    struct { int32_t position[3]; uint32_t uv[2]; } encoded;
+    sf_vertex_encode(&ints, &wide, &encoded, 1);
+    if (ints.stride != sizeof(encoded) || encoded.position[0] != 2 || encoded.position[1] != -3 || encoded.position[2] != 1000
+        || encoded.uv[0] != UINT32_MAX || encoded.uv[1] != 2147483648u) {
+        fprintf(stderr, "32 bit integer attributes encoded incorrectly\n");
+        return -1;
+    }
+    // Both round halfway cases the same way, away from zero, whatever the build.
+    const sf_vertex halfway = {{0, 0, 0}, {2.5f / 65535.0f, 0}, {{2.5f / 255.0f, 4.5f / 255.0f, 0, 1}}};
+    sf_vertex_encode(&compact_layout, &halfway, &compact, 1);
+    sf_vertex_encode(&custom, &halfway, &generic, 1);
+    if (compact.uv[0] != 3 || compact.color[0] != 3 || compact.color[1] != 5 || memcmp(&generic, &compact, sizeof(generic)) != 0) {
+        fprintf(stderr, "Halfway values rounded differently (%u, %u, %u)\n", compact.uv[0], compact.color[0], compact.color[1]);
+        return -1;
+    }
+
+    // Layouts are checked against the locations a program reads, matrices taking one per column.
+    const sf_vertex_layout position_layout = sf_vertex_format_layout(SF_VERTEX_POSITION);
+    if (sf_vertex_layout_locations(&custom) != 0x7u || sf_vertex_layout_locations(&position_layout) != 1u << SF_ATTRIB_POSITION
+        || sf_attrib_columns(GL_FLOAT_MAT4) != 4 || sf_attrib_columns(GL_FLOAT_VEC4) != 1 || sf_attrib_float(GL_INT_VEC2)) {
+        fprintf(stderr, "Layout locations don't match what a program reads\n");
+        return -1;
+    }
+
+    // A layout without attributes has nothing to store, so its meshes take no vertices.
+    const sf_vertex_layout empty_layout = {0};
+    sf_mesh bare = {.layout = empty_layout, .vertices = sf_vertex_data_new(empty_layout.stride)};
+    const sf_mesh_ex bare_add = sf_mesh_add_vertices(&bare, input, 4);
+    if (bare_add.is_ok || bare_add.value.err != SF_MESH_EDIT_NO_ATTRIBS || bare.vertices.count != 0) {
+        fprintf(stderr, "A mesh with no attributes accepted vertices\n");
+        return -1;
+    }
+
+    // Indices stay 16-bit until one doesn't fit.
+    sf_index_data index_data = sf_index_data_new();
+    for (uint32_t i = 0; i <= UINT16_MAX; ++i)
+        sf_index_data_push(&index_data, i);
+    if (index_data.type != GL_UNSIGNED_SHORT || !sf_index_data_push(&index_data, UINT16_MAX + 1u)) {
+        fprintf(stderr, "Indices widened at the wrong time\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i <= UINT16_MAX + 1u; ++i) {
+        if (sf_index_data_get(&index_data, i) != i) {
+            fprintf(stderr, "Index %u was lost while widening\n", i);
+            return -1;
+        }
+    }
+    sf_index_data_free(&index_data);
+
+    // A grid with its triangles shuffled optimizes to a much better cache order, with the same triangles.
+    // sf_mesh_add_raw doesn't touch the gpu, so the mesh is built without a context.
+    const sf_vertex_layout float_layout = sf_vertex_format_layout(SF_VERTEX_FLOAT);
+    sf_mesh mesh = {
+        .layout = float_layout,
+        .vertices = sf_vertex_data_new(float_layout.stride),
+        .indices = sf_index_data_new(),
+        .cache = sf_vertex_table_new(),
+        .bounds = SF_MESH_BOUNDS_EMPTY,
+        .lod_pixels = SF_MESH_LOD_PIXELS,
+    };
+    uint32_t *order = malloc(GRID * GRID * 2 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < GRID * GRID * 2; ++i)
+        order[i] = i;
+    for (uint32_t i = GRID * GRID * 2 - 1, seed = 1; i > 0; --i) {
+        seed = seed * 1664525u + 1013904223u;
+        const uint32_t j = seed % (i + 1), t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (uint32_t i = 0; i < GRID * GRID * 2; ++i) {
+        const float x = (float)(order[i] / 2 % GRID), y = (float)(order[i] / 2 / GRID);
+        const sf_vertex quad[2][3] = {
+            {grid_vertex(x, y), grid_vertex(x + 1, y), grid_vertex(x, y + 1)},
+            {grid_vertex(x + 1, y), grid_vertex(x + 1, y + 1), grid_vertex(x, y + 1)},
+        };
+        sf_mesh_add_raw(&mesh, quad[order[i] % 2], 3);
+    }
+    free(order);
+
+    // Bounds grow with every vertex, and the sphere contains all of them.
+    const sf_mesh_bounds *bounds = &mesh.bounds;
+    if (bounds->min.x != 0 || bounds->min.y != 0 || bounds->max.x != GRID || bounds->max.y != GRID) {
+        fprintf(stderr, "Mesh bounds are wrong\n");
+        return -1;
+    }
+    for (size_t v = 0; v < mesh.vertices.count; ++v) {
+        const sf_vec3 p = ((const sf_vertex *)sf_vertex_data_at(&mesh.vertices, v))->position;
+        const float dx = p.x - bounds->center.x, dy = p.y - bounds->center.y, dz = p.z - bounds->center.z;
+        if (sqrtf(dx * dx + dy * dy + dz * dz) > bounds->radius * 1.0001f) {
+            fprintf(stderr, "Vertex %zu is outside the bounding sphere\n", v);
+            return -1;
+        }
+    }
+
+    const uint64_t checksum = triangle_checksum(&mesh);
+    const size_t mesh_vertices = mesh.vertices.count;
+    const sf_mesh_optimize_report report = sf_mesh_optimize(&mesh, SF_OPTIMIZE_OVERDRAW);
+    if (report.after.acmr >= report.before.acmr || report.after.acmr > 0.8f || report.after.atvr > 1.6f) {
+        fprintf(stderr, "Optimizing a grid didn't help (acmr %.3f -> %.3f, atvr %.3f -> %.3f)\n",
+            (double)report.before.acmr, (double)report.after.acmr, (double)report.before.atvr, (double)report.after.atvr);
+        return -1;
+    }
+    if (triangle_checksum(&mesh) != checksum || mesh.vertices.count != mesh_vertices) {
+        fprintf(stderr, "Optimizing changed the triangles of a mesh\n");
+        return -1;
+    }
+    for (uint32_t i = 0, next = 0; i < mesh.indices.count; ++i) {
+        const uint32_t index = sf_index_data_get(&mesh.indices, i);
+        if (index > next) {
+            fprintf(stderr, "Vertices aren't in the order they are first used\n");
+            return -1;
+        }
+        if (index == next) next++;
+    }
+    // The rebuilt table still deduplicates against the moved vertices.
+    const sf_vertex corner = grid_vertex(0, 0);
+    sf_mesh_add_raw(&mesh, &corner, 1);
+    if (mesh.vertices.count != mesh_vertices) {
+        fprintf(stderr, "Deduplication table is stale after optimizing\n");
+        return -1;
+    }
+
+    // Each level of detail has fewer triangles and more error than the last, and uses the same vertices.
+    const size_t full_count = mesh.indices.count;
+    if (sf_mesh_generate_lods(&mesh, 4, 0.5f) < 3) {
+        fprintf(stderr, "Only generated %u levels of detail\n", mesh.lod_count);
+        return -1;
+    }
+    for (uint8_t l = 1; l < mesh.lod_count; ++l) {
+        const sf_mesh_lod *lod = mesh.lods + l, *prev = mesh.lods + l - 1;
+        if (lod->count >= prev->count || lod->count % 3 || lod->error < prev->error || lod->offset != prev->offset + prev->count) {
+            fprintf(stderr, "Level of detail %u is malformed (%zu indices, error %f)\n", l, lod->count, (double)lod->error);
+            return -1;
+        }
+        for (size_t i = lod->offset; i < lod->offset + lod->count; ++i) {
+            if (sf_index_data_get(&mesh.indices, i) >= mesh.vertices.count) {
+                fprintf(stderr, "Level of detail %u uses a vertex that doesn't exist\n", l);
+                return -1;
+            }
+        }
+    }
+
+    // Flattening a bump reports an error on the scale of its height, in the units of the positions.
+    const float bump = bump_error(2.0f);
+    if (bump < 0.5f || bump > 2.0f) {
+        fprintf(stderr, "Flattening a bump of height 2 reported an error of %f\n", (double)bump);
+        return -1;
+    }
+
+    sf_camera camera = sf_camera_new(SF_CAMERA_PERSPECTIVE, glm_rad(60.0f), 0.1f, 10000.0f);
+    camera.viewport = (sf_vec2){1280, 720};
+    glm_perspective(camera.fov, camera.viewport.x / camera.viewport.y, camera.near, camera.far, camera.projection);
+    const sf_transform identity = SF_TRANSFORM_IDENTITY;
+    camera.transform.position = (sf_vec3){GRID / 2.0f, GRID / 2.0f, 40.0f};
+    if (sf_mesh_lod_select(&mesh, &camera, identity) != 0) {
+        fprintf(stderr, "A close mesh wasn't drawn at full detail\n");
+        return -1;
+    }
+
+    // Cameras look down -z, so the grid is in view from above and culled from below.
+    mat4 model;
+    glm_mat4_identity(model);
+    sf_frustum frustum = sf_camera_frustum(&camera);
+    if (!sf_mesh_in_view(&mesh, &frustum, model)) {
+        fprintf(stderr, "A mesh in front of the camera was culled\n");
+        return -1;
+    }
+    camera.transform.position.z = -100.0f;
+    frustum = sf_camera_frustum(&camera);
+    if (sf_mesh_in_view(&mesh, &frustum, model)) {
+        fprintf(stderr, "A mesh behind the camera wasn't culled\n");
+        return -1;
+    }
+
+    camera.transform.position.z = 8000.0f;
+    if (sf_mesh_lod_select(&mesh, &camera, identity) != mesh.lod_count - 1) {
+        fprintf(stderr, "A distant mesh wasn't drawn at the lowest detail\n");
+        return -1;
+    }
+
+    // Saved meshes start with a header describing aligned blobs.
+    if (!sf_mesh_save(&mesh, sf_lit("vertices_test.sfmesh")).is_ok) {
+        fprintf(stderr, "Couldn't save a mesh\n");
+        return -1;
+    }
+    FILE *file = fopen("vertices_test.sfmesh", "rb");
+    sf_mesh_file_header header = {0};
+    const bool read = file && fread(&header, sizeof(header), 1, file) == 1;
+    if (file) fclose(file);
+    if (!read || header.magic != SF_MESH_FILE_MAGIC || header.vertex_count != mesh.vertices.count
+        || header.index_count != mesh.indices.count || header.lod_count != mesh.lod_count
+        || header.vertex_offset % SF_MESH_FILE_ALIGN || header.index_offset % SF_MESH_FILE_ALIGN) {
+        remove("vertices_test.sfmesh");
+        fprintf(stderr, "Saved mesh has a bad header\n");
+        return -1;
+    }
+
+    // A file from another version of the format is rejected before anything reaches the context.
+    header.version = SF_MESH_FILE_VERSION + 1;
+    file = fopen("vertices_test.sfmesh", "r+b");
+    const bool bumped = file && fwrite(&header, sizeof(header), 1, file) == 1;
+    if (file) fclose(file);
+    const sf_mesh_file_ex versioned = sf_mesh_load_mapped(sf_lit("vertices_test.sfmesh"));
+    if (!bumped || versioned.is_ok || versioned.value.err != SF_MESH_FILE_WRONG_VERSION) {
+        remove("vertices_test.sfmesh");
+        fprintf(stderr, "A mesh file from another format version wasn't rejected as one\n");
+        return -1;
+    }
+
+    // So is one written on a machine of the other byte order.
+    header.version = SF_MESH_FILE_VERSION;
+    header.magic = SF_MESH_FILE_MAGIC_SWAPPED;
+    file = fopen("vertices_test.sfmesh", "r+b");
+    const bool swapped = file && fwrite(&header, sizeof(header), 1, file) == 1;
+    if (file) fclose(file);
+    const sf_mesh_file_ex foreign = sf_mesh_load_mapped(sf_lit("vertices_test.sfmesh"));
+    if (!swapped || foreign.is_ok || foreign.value.err != SF_MESH_FILE_WRONG_BYTE_ORDER) {
+        remove("vertices_test.sfmesh");
+        fprintf(stderr, "A mesh file of the other byte order wasn't rejected as one\n");
+        return -1;
+    }
+
+    // And one with an index past its vertices, which would have the gpu read out of bounds.
+    header.magic = SF_MESH_FILE_MAGIC;
+    const uint32_t stray = (uint32_t)mesh.vertices.count;
+    const uint16_t narrow_stray = (uint16_t)stray;
+    const void *stray_bytes = header.index_type == GL_UNSIGNED_SHORT ? (const void *)&narrow_stray : (const void *)&stray;
+    file = fopen("vertices_test.sfmesh", "r+b");
+    const bool strayed = file && fwrite(&header, sizeof(header), 1, file) == 1
+        && fseek(file, (long)header.index_offset, SEEK_SET) == 0
+        && fwrite(stray_bytes, sf_index_size(header.index_type), 1, file) == 1;
+    if (file) fclose(file);
+    const sf_mesh_file_ex out_of_range = sf_mesh_load_mapped(sf_lit("vertices_test.sfmesh"));
+    remove("vertices_test.sfmesh");
+    if (!strayed || out_of_range.is_ok || out_of_range.value.err != SF_MESH_FILE_INVALID) {
+        fprintf(stderr, "A mesh file with an out of range index wasn't rejected\n");
+        return -1;
+    }
+
+    // Loading needs a context; without a display, the round trip is all that's skipped.
+    sf_camera view = sf_camera_new(SF_CAMERA_PERSPECTIVE, 90, 0.1f, 100.0f);
+    const sf_window_ex wx = sf_window_new(sf_lit("Vertices Test"), (sf_vec2){64, 64}, &view, 0);
+    if (wx.is_ok) {
+        const bool saved = sf_mesh_save(&mesh, sf_lit("vertices_test.sfmesh")).is_ok;
+        sf_mesh_file_ex loaded = sf_mesh_load_mapped(sf_lit("vertices_test.sfmesh"));
+        remove("vertices_test.sfmesh");
+        if (!saved || !loaded.is_ok) {
+            fprintf(stderr, "Couldn't load a saved mesh\n");
+            return -1;
+        }
+        sf_mesh *back = &loaded.value.ok;
+        bool same = back->vertices.count == mesh.vertices.count && back->vertices.stride == mesh.vertices.stride
+            && back->indices.count == mesh.indices.count && back->indices.type == mesh.indices.type
+            && back->lod_count == mesh.lod_count
+            && memcmp(back->vertices.data, mesh.vertices.data, mesh.vertices.count * mesh.vertices.stride) == 0
+            && memcmp(back->indices.data, mesh.indices.data, mesh.indices.count * sf_index_size(mesh.indices.type)) == 0;
+        for (uint8_t i = 0; same && i < mesh.lod_count; ++i)
+            same = back->lods[i].offset == mesh.lods[i].offset && back->lods[i].count == mesh.lods[i].count
+                && back->lods[i].error == mesh.lods[i].error;
+        sf_mesh_delete(back);
+        sf_window_close(wx.value.ok);
+        if (!same) {
+            fprintf(stderr, "A loaded mesh doesn't match the one saved\n");
+            return -1;
+        }
+    } else fprintf(stderr, "No context, so saved meshes weren't loaded back\n");
+    sf_camera_delete(&view);
+
+    // Adding vertices drops the levels of detail.
+    sf_mesh_add_raw(&mesh, &corner, 1);
+    if (mesh.lod_count != 0 || mesh.indices.count != full_count + 1) {
+        fprintf(stderr, "Levels of detail survived adding a vertex\n");
+        return -1;
+    }
+
+    // Freezing keeps the counts and drops everything else; the mesh is marked clean so nothing is uploaded.
+    const size_t frozen_vertices = mesh.vertices.count, frozen_indices = mesh.indices.count;
+    mesh.dirty_vertices = mesh.dirty_indices = (sf_mesh_range){0, 0};
+    sf_mesh_freeze(&mesh);
+    if (mesh.vertices.data || mesh.indices.data || mesh.cache.slots
+        || mesh.vertices.count != frozen_vertices || mesh.indices.count != frozen_indices) {
+        fprintf(stderr, "Freezing kept cpu data or lost counts\n");
+        return -1;
+    }
+    const sf_mesh_ex frozen = sf_mesh_add_raw(&mesh, &corner, 1);
+    if (frozen.is_ok || frozen.value.err != SF_MESH_EDIT_FROZEN || mesh.indices.count != frozen_indices) {
+        fprintf(stderr, "A frozen mesh accepted new vertices\n");
+        return -1;
+    }
+
+    free(batch.hashes);
+    free(batch.unique);
+    free(batch.remap);
+    sf_vertex_table_free(&table);
+    free(indices);
+    free(pool);
+    free(input);
+    return 0;
+}
@@ -8,6 +8,7 @@
 #include <errno.h>
 #include <sf/gfx/window.h>
 #include <stdio.h>
+#include "test_shaders.h"
 
 int main(int argc, char **argv) {
     sf_vec2 window_size = {1280, 720};
@@ -48,6 +49,8 @@ int main(int argc, char **argv) {
     }
     sf_window *win = wx.value.ok;
 
+    // The shaders are compiled in, so they load without reading tests/assets.
+    sf_shader_embed(test_shaders, TEST_SHADERS_COUNT);
     sf_shader_ex sx = sf_shader_new(sf_lit("tests/assets/shaders/default"));
     if (!sx.is_ok) {
         switch (sx.value.err.type) {
@@ -59,6 +62,13 @@ int main(int argc, char **argv) {
     }
     sf_shader def = sx.value.ok;
 
+    sx = sf_shader_new(sf_lit("tests/assets/shaders/instanced"));
+    if (!sx.is_ok) {
+        fprintf(stderr, "Instanced shader failed: %s\n", sx.value.err.type == SF_SHADER_COMPILE_ERROR ? sx.value.err.compile_err.c_str : "missing");
+        return -1;
+    }
+    sf_shader instanced = sx.value.ok;
+
     sf_mesh box = sf_mesh_new();
     sf_mesh_add_vertices(&box, (sf_vertex[]){
         {{-1.0f, -1.0f, 0.0f}, {1.0f, 1.0f}, sf_rgbagl(SF_WHITE)},
@@ -81,10 +91,31 @@ int main(int argc, char **argv) {
     }
     sf_texture doom = dx.value.ok;
 
+    // The main box draws through a material, which binds the texture and sampler together.
+    sf_material doom_material = sf_material_new(&def);
+    sf_material_set_texture(&doom_material, 0, sf_lit("t_sampler"), &doom);
+
+    // Edits to the shaders and texture under tests/assets show up without restarting.
+    win->reloader = sf_reloader_new();
+    sf_reloader_watch_shader(win->reloader, &def);
+    sf_reloader_watch_shader(win->reloader, &instanced);
+    sf_reloader_watch_texture(win->reloader, &doom);
+
     main_cam->transform.position = (sf_vec3){0, 0, 10};
 
     sf_transform identity = SF_TRANSFORM_IDENTITY;
     identity.scale = (sf_vec3){5, 5, 5};
+
+    // A floor of props behind the main box, all drawn in a single call.
+    enum { PROPS = 32 };
+    sf_transform *props = malloc(PROPS * PROPS * sizeof(sf_transform));
+    assert(props);
+    sf_transform prop = SF_TRANSFORM_IDENTITY;
+    prop.scale = (sf_vec3){0.5f, 0.5f, 0.5f};
+    for (int i = 0; i < PROPS * PROPS; ++i) {
+        props[i] = prop;
+        props[i].position = (sf_vec3){(float)(i % PROPS - PROPS / 2) * 3, -6, -(float)(i / PROPS) * 3};
+    }
     while (sf_window_loop(win)) {
         sf_vec3 input = {
             sf_key_check(win, SF_KEY_LEFT_ARROW) - sf_key_check(win, SF_KEY_RIGHT_ARROW),
@@ -93,11 +124,14 @@ int main(int argc, char **argv) {
         };
         main_cam->transform.position = sf_vec3_add(main_cam->transform.position, sf_vec3_multf(input, 0.1f));
 
-        sf_draw_ex d = sf_mesh_draw(&box, &def, main_cam, identity, &doom);
+        // Queued draws are sorted and drawn together in sf_window_draw.
+        sf_window_submit_material(win, &box, &doom_material, main_cam, identity);
+        sf_draw_ex d = sf_mesh_draw_instanced(&box, &instanced, main_cam, props, PROPS * PROPS, &doom);
         if (!d.is_ok) {
             switch (d.value.err.type) {
                 case SF_DRAW_UNKNOWN_UNIFORM: fprintf(stderr, "[Draw] Unknown uniform: '%s'\n", d.value.err.value.uniform_name.c_str); break;
                 case SF_DRAW_SHADER_MISSING: fprintf(stderr, "[Draw] How\n"); break;
+                case SF_DRAW_ATTRIB_MISMATCH: fprintf(stderr, "[Draw] Mesh can't feed attribute: '%s'\n", d.value.err.value.attrib_name.c_str); break;
             }
         }
         d = sf_window_draw(win, &def);
@@ -105,10 +139,15 @@ int main(int argc, char **argv) {
             switch (d.value.err.type) {
                 case SF_DRAW_UNKNOWN_UNIFORM: fprintf(stderr, "[Draw] Unknown uniform: '%s'\n", d.value.err.value.uniform_name.c_str); break;
                 case SF_DRAW_SHADER_MISSING: fprintf(stderr, "[Draw] How\n"); break;
+                case SF_DRAW_ATTRIB_MISMATCH: fprintf(stderr, "[Draw] Mesh can't feed attribute: '%s'\n", d.value.err.value.attrib_name.c_str); break;
             }
         }
     }
 
+    free(props);
+    sf_reloader_free(win->reloader);
+    sf_material_free(&doom_material);
+    sf_shader_free(&instanced);
     sf_shader_free(&def);
     sf_texture_delete(&doom);
     sf_mesh_delete(&box);